@@ -0,0 +1,821 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_BENCHMARK_H
+#define FLOCK_COMPILER_BENCHMARK_H
+
+#include "Util.h"
+#include "Supplier.h"
+#include "CachedSupplier.h"
+#include "ConsoleCharSupplier.h"
+#include "FileCharSupplier.h"
+#include "LocationSupplier.h"
+#include "MappedSource.h"
+#include "SourceEvaluation.h"
+#include "RuleMachine.h"
+#include "DeferredEvaluation.h"
+#include "RuleHistory.h"
+#include "RuleOptimiser.h"
+#include "SyntaxTree.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+ ///
+ /// Micro benchmarks, run with --bench <file>.
+ ///
+namespace flock {
+	namespace benchmark {
+		using namespace supplier;
+		using namespace rule;
+
+		/// <summary>
+		/// How many elements a run got through, and how long it took.
+		/// </summary>
+		struct BenchmarkResult {
+			string name;
+			size_t elements = 0;
+			double seconds = 0;
+
+			double perSecond() const {
+				return seconds > 0 ? elements / seconds : 0;
+			}
+		};
+
+		static std::ostream& operator<<(std::ostream& os, const BenchmarkResult& result) {
+			return os << std::left << std::setw(48) << result.name << std::right << std::setw(12) << result.elements << " in "
+				<< std::fixed << std::setprecision(4) << result.seconds << "s, "
+				<< std::setprecision(1) << result.perSecond() / 1e6 << "M/s\n";
+		}
+
+		/// <summary>
+		/// Times run, which returns how many elements it got through.
+		/// Runs it a few times, and keeps the quickest, to keep the noise down.
+		/// </summary>
+		template<typename RUN>
+		static BenchmarkResult measure(const string name, RUN run, const int repeats = 5) {
+			BenchmarkResult result;
+			result.name = name;
+			for (int i = 0; i < repeats; i++) {
+				const auto started = std::chrono::steady_clock::now();
+				const size_t elements = run();
+				const std::chrono::duration<double> taken = std::chrono::steady_clock::now() - started;
+				if (i == 0 || taken.count() < result.seconds) {
+					result.seconds = taken.count();
+					result.elements = elements;
+				}
+			}
+			return result;
+		}
+
+		/// <summary>
+		/// The supplier, without the compiler knowing what it is, so the calls stay virtual the way they are in the evaluator.
+		/// </summary>
+		static Supplier<int>* opaque(Supplier<int>& supplier) {
+			Supplier<int>* volatile hidden = &supplier;
+			return hidden;
+		}
+
+		/// <summary>
+		/// Drains a supplier a character at a time, up to limit.
+		/// </summary>
+		static size_t drainEach(Supplier<int>& supplier, const size_t limit) {
+			Supplier<int>* const target = opaque(supplier);
+			size_t count = 0;
+			while (count < limit && target->supply() != EOF) {
+				count++;
+			}
+			return count;
+		}
+
+		/// <summary>
+		/// Drains a supplier a block at a time, up to limit.
+		/// </summary>
+		static size_t drainBlocks(Supplier<int>& supplier, const size_t limit) {
+			Supplier<int>* const target = opaque(supplier);
+			std::vector<int> block(4096);
+			size_t count = 0;
+			while (count < limit) {
+				const int filled = target->supplyInto(block.data(), static_cast<int>(std::min<size_t>(block.size(), limit - count)));
+				if (filled == 0) {
+					break;
+				}
+				count += filled;
+			}
+			return count;
+		}
+
+		/// <summary>
+		/// Hides whatever supplyInto the wrapped supplier has, so everything goes through supply(), the way it used to.
+		/// </summary>
+		class EachCharSupplier : public Supplier<int> {
+		public:
+			EachCharSupplier(_sp<Supplier<int>> wrapped) : wrapped(wrapped) {}
+			int supply() override {
+				return wrapped->supply();
+			}
+		protected:
+			_sp<Supplier<int>> wrapped;
+		};
+
+		/// <summary>
+		/// Boxes up the characters of a file, so the cached supplier has something to cache.
+		/// Boxes are shared by character, so it is the supplier being measured, not the allocator.
+		/// </summary>
+		class BoxedCharSupplier : public CachedVectorSupplier<int> {
+		public:
+			BoxedCharSupplier(_sp<MappedSource> source, const bool blocks) : chars(source), blocks(blocks), boxes(256) {
+				for (int i = 0; i < 256; i++) {
+					boxes[i] = std::make_shared<int>(i);
+				}
+			}
+
+			_sp<int> supply() override {
+				const int next = chars.supply();
+				return next == EOF ? nullptr : boxes[next];
+			}
+
+			// a mapped file never has to wait for its next character.
+			bool isAvailable() override {
+				return true;
+			}
+
+			int supplyInto(_sp<int>* into, const int amount) override {
+				if (!blocks) {
+					return CachedVectorSupplier<int>::supplyInto(into, amount);
+				}
+				if (static_cast<int>(block.size()) < amount) {
+					block.resize(amount);
+				}
+				const int count = chars.supplyInto(block.data(), amount);
+				for (int i = 0; i < count; i++) {
+					into[i] = boxes[block[i]];
+				}
+				return count;
+			}
+		protected:
+			FileCharSupplier chars;
+			const bool blocks;
+			_sp_vec<int> boxes;
+			std::vector<int> block;
+		};
+
+		/// <summary>
+		/// Polls every position of the source in turn, popping as it goes, the way the evaluator walks it.
+		/// </summary>
+		static size_t walk(LocationSupplier& locations) {
+			size_t count = 0;
+			while (locations.poll(locations.getStart()) != EOF) {
+				locations.popRange(1);
+				count++;
+			}
+			return count;
+		}
+
+		static size_t walk(CachedSupplier<int>& cached) {
+			size_t count = 0;
+			while (cached.poll(0)) {
+				cached.popRange(1);
+				count++;
+			}
+			return count;
+		}
+
+		/// <summary>
+		/// Characters per second through each supplier, a character at a time, and then in blocks.
+		/// </summary>
+		static void runSupplierBenchmarks(const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			const size_t limit = source->size();
+			out << "Suppliers over " << fileName << ", " << limit << " characters\n";
+
+			out << measure("FileCharSupplier supply", [&]() {
+				FileCharSupplier supplier(source);
+				return drainEach(supplier, limit);
+			});
+			out << measure("FileCharSupplier supplyInto", [&]() {
+				FileCharSupplier supplier(source);
+				return drainBlocks(supplier, limit);
+			});
+
+			out << measure("StreamCharSupplier supply", [&]() {
+				std::ifstream file(fileName, std::ios::binary);
+				StreamCharSupplier supplier(file);
+				return drainEach(supplier, limit);
+			});
+			out << measure("StreamCharSupplier supplyInto", [&]() {
+				std::ifstream file(fileName, std::ios::binary);
+				StreamCharSupplier supplier(file);
+				return drainBlocks(supplier, limit);
+			});
+
+			// the console reads std::cin, so point that at the file for the duration.
+			// an end marker that can't be a line keeps blank lines from stopping it, the limit stops it instead.
+			const auto consoleRun = [&](const bool blocks) {
+				std::ifstream file(fileName, std::ios::binary);
+				std::streambuf* console = std::cin.rdbuf(file.rdbuf());
+				ConsoleCharSupplier supplier("\n");
+				const size_t count = blocks ? drainBlocks(supplier, limit) : drainEach(supplier, limit);
+				std::cin.rdbuf(console);
+				std::cin.clear();
+				return count;
+			};
+			out << measure("ConsoleCharSupplier supply", [&]() { return consoleRun(false); });
+			out << measure("ConsoleCharSupplier supplyInto", [&]() { return consoleRun(true); });
+
+			out << measure("LocationSupplier, supply", [&]() {
+				LocationSupplier locations(std::make_shared<EachCharSupplier>(std::make_shared<FileCharSupplier>(source)));
+				return walk(locations);
+			});
+			out << measure("LocationSupplier, supplyInto", [&]() {
+				LocationSupplier locations(std::static_pointer_cast<Supplier<int>>(std::make_shared<FileCharSupplier>(source)));
+				return walk(locations);
+			});
+			out << measure("LocationSupplier, whole mapping", [&]() {
+				LocationSupplier locations(source);
+				return walk(locations);
+			});
+
+			out << measure("CachedSupplier, supply", [&]() {
+				BoxedCharSupplier cached(source, false);
+				return walk(cached);
+			});
+			out << measure("CachedSupplier, supplyInto", [&]() {
+				BoxedCharSupplier cached(source, true);
+				return walk(cached);
+			});
+		}
+
+		/// <summary>
+		/// Parses the whole source, a symbol at a time, the way main does.
+		/// Anything no symbol matches is skipped a character at a time, so the whole source is measured whatever the library.
+		/// </summary>
+		static size_t parseAll(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, _sp<MappedSource> source) {
+			_sp<LocationSupplier> locations = std::make_shared<LocationSupplier>(source);
+			_sp<evaluator::EvaluationVisitor> visitor = std::make_shared<evaluator::EvaluationVisitor>(library, strategies);
+			while (true) {
+				visitor->clear();
+				strategies->clear();
+				evaluator::Input input = evaluator::Input(locations);
+				evaluator::Output output = visitor->begin(input);
+				if (output.isFailure() || output.idx == input.idx) {
+					if (locations->isEnd(input.idx)) {
+						break;
+					}
+					locations->popRange(1);
+				}
+			}
+			return locations->getStart();
+		}
+
+		/// <summary>
+		/// Characters per second through the library, walking the rules, with and without first sets, without scanning spans, and optimised,
+		/// only recognising, with and without deferring the nodes, and then with the machine.
+		/// </summary>
+		static void runParseBenchmarks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			out << "Parsing " << fileName << "\n";
+			// walking the rules is slow enough to not need repeating.
+			out << measure("evaluationStrategies", [&]() {
+				return parseAll(library, evaluator::evaluationStrategies(), source);
+			}, 1);
+			out << measure("evaluationStrategies, no first sets", [&]() {
+				return parseAll(library, evaluator::evaluationStrategies(history::memoiseProductions(), nullptr), source);
+			}, 1);
+			out << measure("evaluationStrategies, no spans", [&]() {
+				return parseAll(library, evaluator::evaluationStrategies(history::memoiseProductions(), make_shared<evaluator::FirstSetPruning>(), nullptr), source);
+			}, 1);
+			const _sp<RuleLibrary> optimised = optimiser::optimise(library);
+			out << measure("evaluationStrategies, optimised rules", [&]() {
+				return parseAll(optimised, evaluator::evaluationStrategies(), source);
+			}, 1);
+			out << measure("recognitionStrategies", [&]() {
+				return parseAll(library, evaluator::recognitionStrategies(), source);
+			}, 1);
+			out << measure("deferredStrategies", [&]() {
+				return parseAll(library, deferred::deferredStrategies(), source);
+			}, 1);
+			const auto compiled = machine::machineStrategies(library);
+			out << measure("machineStrategies", [&]() {
+				return parseAll(library, compiled, source);
+			});
+		}
+
+		/// <summary>
+		/// The work factoring the ors saves over a file, the optimised library parsed with and without it, by how many rules were visited,
+		/// and how many of those visits the memo table answered, which is what it would otherwise have cost to try the same start twice.
+		/// </summary>
+		static void runFactoringBenchmarks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			out << "Left factoring over " << fileName << "\n";
+			vector<_sp<optimiser::RulePass>> unfactored;
+			for (const _sp<optimiser::RulePass>& pass : optimiser::defaultPasses()) {
+				if (!std::dynamic_pointer_cast<optimiser::LeftFactorPass>(pass)) {
+					unfactored.push_back(pass);
+				}
+			}
+			size_t visits[2] = {};
+			for (const bool factored : { false, true }) {
+				const _sp<RuleLibrary> optimised = factored ? optimiser::optimise(library) : optimiser::optimise(library, unfactored);
+				_sp<Strategies<evaluator::Input, evaluator::Output>> strategies;
+				out << measure(string("evaluationStrategies, ") + (factored ? "left factored" : "not left factored"), [&]() {
+					strategies = evaluator::evaluationStrategies();
+					return parseAll(optimised, strategies, source);
+				}, 1);
+				const auto caching = visitor::findStrategies<history::CachingStrategies<evaluator::Input, evaluator::Output, evaluator::Key>>(strategies);
+				const history::MemoStats& stats = caching->getMemo()->getStats();
+				out << "    " << stats.visits << " rules visited, " << stats.hits << " answered by the memo table\n";
+				visits[factored] = stats.visits;
+			}
+			const double saved = visits[0] > 0 ? 100.0 * (static_cast<double>(visits[0]) - static_cast<double>(visits[1])) / visits[0] : 0;
+			out << std::setprecision(1) << "    factoring saved " << static_cast<long long>(visits[0]) - static_cast<long long>(visits[1]) << " visits, " << saved << "%\n";
+		}
+
+		/// <summary>
+		/// The nodes made parsing the whole source, the same way parseAll goes through it, printed one to a line, and where each was made.
+		/// </summary>
+		static string printAll(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, _sp<LocationSupplier> locations) {
+			_sp<evaluator::EvaluationVisitor> visitor = std::make_shared<evaluator::EvaluationVisitor>(library, strategies);
+			std::ostringstream printed;
+			while (true) {
+				visitor->clear();
+				strategies->clear();
+				evaluator::Input input = evaluator::Input(locations);
+				evaluator::Output output = visitor->begin(input);
+				if (output.isFailure() || output.idx == input.idx) {
+					if (locations->isEnd(input.idx)) {
+						break;
+					}
+					locations->popRange(1);
+					continue;
+				}
+				for (const _sp<SyntaxNode>& node : output.getNodes()) {
+					printed << input.idx << " " << *node << "\n";
+				}
+			}
+			return printed.str();
+		}
+		static string printAll(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, _sp<MappedSource> source) {
+			return printAll(library, strategies, std::make_shared<LocationSupplier>(source));
+		}
+		static string printAll(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, const string& text) {
+			std::istringstream in(text);
+			return printAll(library, strategies, make_shared<LocationSupplier>(std::static_pointer_cast<Supplier<int>>(make_shared<StreamCharSupplier>(in))));
+		}
+
+		/// <summary>
+		/// Whether the library makes the same nodes of the source, for each memo policy, optimised with the passes picked for the policy as it does unoptimised.
+		/// </summary>
+		static bool runOptimiserChecks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			bool same = true;
+			for (const auto mode : { history::MemoMode::All, history::MemoMode::Productions, history::MemoMode::Symbols }) {
+				const _sp<RuleLibrary> optimised = optimiser::optimise(library, optimiser::passesFor(mode));
+				const bool matched = printAll(optimised, evaluator::evaluationStrategies(make_shared<history::MemoPolicy>(mode)), source)
+					== printAll(library, evaluator::evaluationStrategies(make_shared<history::MemoPolicy>(mode)), source);
+				out << "optimised rules, memoise " << history::MemoPolicy::modeName(mode) << (matched ? ", same nodes" : ", different nodes") << "\n";
+				same = same && matched;
+			}
+			return same;
+		}
+
+		/// <summary>
+		/// Whether adaptive policies make the same nodes as remembering every rule, over the source, and over a left recursion
+		/// whose rule is switched off and back on while it is still running further out, which has to keep failing where it recurses.
+		/// </summary>
+		static bool runAdaptiveChecks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			const string expected = printAll(library, evaluator::evaluationStrategies(history::memoiseAll()), source);
+			bool same = true;
+			for (const auto mode : { history::MemoMode::All, history::MemoMode::Productions }) {
+				const _sp<history::MemoPolicy> policy = make_shared<history::MemoPolicy>(mode);
+				policy->adapt();
+				const bool matched = printAll(library, evaluator::evaluationStrategies(policy), source) == expected;
+				out << "memoise " << history::MemoPolicy::modeName(mode) << ", adaptive" << (matched ? ", same nodes" : ", different nodes") << " as memoise all\n";
+				same = same && matched;
+			}
+
+			const _sp<RuleLibrary> recursive = make_shared<RuleLibrary>();
+			recursive->addSymbol("e", OR({ SEQ({ NOT(SEQ({ ANY(), RULE("e"), EQ('!') })), RULE("e"), EQ('+'), DIGIT() }), DIGIT() }));
+			recursive->freeze();
+			// off after its first store, while the run of it that stored is still going further out.
+			history::MemoCostModel off;
+			off.warmUp = 1;
+			off.minReuse = 10;
+			// already off, and back on after two visits, while the guarded run of it further out is still going.
+			history::MemoCostModel on;
+			on.warmUp = 100;
+			on.window = 2;
+			on.maxReevaluation = -1;
+			for (const string text : { "1+2", "1+2+3", "1+2+3+4" }) {
+				const string recursed = printAll(recursive, evaluator::evaluationStrategies(history::memoiseAll()), text);
+				for (const auto mode : { history::MemoMode::All, history::MemoMode::Productions }) {
+					for (const bool switchingOn : { false, true }) {
+						const _sp<history::MemoPolicy> policy = make_shared<history::MemoPolicy>(mode);
+						policy->adapt(off);
+						if (switchingOn) {
+							printAll(recursive, evaluator::evaluationStrategies(policy), "1");
+							policy->adapt(on);
+						}
+						const bool matched = printAll(recursive, evaluator::evaluationStrategies(policy), text) == recursed;
+						const history::AdaptationStats& adapted = policy->getAdaptationStats();
+						const bool switched = switchingOn ? adapted.switchedOn > 0 : adapted.switchedOff > 0;
+						out << "left recursion over " << text << ", memoise " << history::MemoPolicy::modeName(mode) << ", adaptive, switched off " << adapted.switchedOff
+							<< " times, back on " << adapted.switchedOn << (matched ? ", same nodes" : ", different nodes") << " as memoise all\n";
+						same = same && matched && switched;
+					}
+				}
+			}
+			return same;
+		}
+
+		/// <summary>
+		/// A symbol repeated count times, each one a node, so the cost of joining outputs is what is measured.
+		/// </summary>
+		static void runRepeatBenchmarks(std::ostream& out) {
+			const _sp<RuleLibrary> library = make_shared<RuleLibrary>();
+			library->addSymbol("a", EQ('a'));
+			library->addSymbol("as", REP(RULE("a")));
+			library->freeze();
+			// a million deep, as a rope, which has to be released without recursing.
+			for (const int count : { 1000, 10000, 100000, 1000000 }) {
+				const string text(count, 'a');
+				size_t nodes = 0;
+				out << measure("repeat of " + to_string(count) + " symbols", [&]() {
+					std::istringstream in(text);
+					const _sp<LocationSupplier> tokens = make_shared<LocationSupplier>(std::static_pointer_cast<Supplier<int>>(make_shared<StreamCharSupplier>(in)));
+					const auto visitor = make_shared<evaluator::EvaluationVisitor>(library, evaluator::evaluationStrategies());
+					const evaluator::Output output = visitor->begin(evaluator::Input(tokens));
+					nodes = output.getNodes().at(0)->getChildren().size();
+					return static_cast<size_t>(output.idx);
+				}, 3);
+				if (nodes != static_cast<size_t>(count)) {
+					out << "    expected " << count << " nodes, got " << nodes << "\n";
+				}
+			}
+		}
+
+		/// <summary>
+		/// Parses the text, a symbol at a time, streamed in as it would be from a console, until nothing matches.
+		/// </summary>
+		static size_t parseText(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, const string& text) {
+			std::istringstream in(text);
+			const _sp<LocationSupplier> tokens = make_shared<LocationSupplier>(std::static_pointer_cast<Supplier<int>>(make_shared<StreamCharSupplier>(in)));
+			const auto visitor = make_shared<evaluator::EvaluationVisitor>(library, strategies);
+			while (true) {
+				visitor->clear();
+				strategies->clear();
+				const evaluator::Input input = evaluator::Input(tokens);
+				const evaluator::Output output = visitor->begin(input);
+				if (output.isFailure() || output.idx == input.idx) {
+					break;
+				}
+			}
+			return static_cast<size_t>(tokens->getStart());
+		}
+
+		/// <summary>
+		/// A long comment of each kind, a long run of whitespace and a long number, each one symbol over a repeat of a class of characters, or up to a literal,
+		/// so how quickly the repeat gets through them is what is measured, with a scan for the run, and a match at a time.
+		/// </summary>
+		static void runSpanBenchmarks(std::ostream& out) {
+			const _sp<RuleLibrary> library = make_shared<RuleLibrary>();
+			library->addSymbol("comment", SEQ(EQ("//"), UNTIL(NEW_LINE())));
+			library->addSymbol("block", SEQ({ EQ("/*"), UNTIL(EQ("*/")), EQ("*/") }));
+			library->addSymbol("space", REP(1, 0, WHITESPACE()));
+			library->addSymbol("number", REP(1, 0, DIGIT()));
+			library->freeze();
+			const int count = 1000000;
+			// every printable character, in order, so the block comment never closes early.
+			string line;
+			for (int i = 0; i < count; i++) {
+				line += static_cast<char>(' ' + i % 95);
+			}
+			const string text = "//" + line + "\n/*" + line + "*/" + string(count, ' ') + string(count, '0');
+			for (const bool spans : { true, false }) {
+				out << measure(string("evaluationStrategies, ") + (spans ? "spans" : "no spans") + " over " + to_string(count) + " characters", [&]() {
+					return parseText(library, evaluator::evaluationStrategies(history::memoiseProductions(), make_shared<evaluator::FirstSetPruning>(),
+						spans ? make_shared<evaluator::CharacterSpans>() : nullptr), text);
+				}, 3);
+			}
+		}
+
+		/// <summary>
+		/// Words that are all keywords, matched as one equals of every keyword, and as an or of an equals each, longest first,
+		/// so the cost of finding which keyword is at a position is what is measured, with a walk of a trie, and a compare per keyword.
+		/// </summary>
+		static void runKeywordBenchmarks(std::ostream& out) {
+			const vector<string> keywords = { "use", "import", "export", "module", "class", "struct", "enum", "union", "interface", "trait", "impl", "function", "fn",
+				"let", "var", "const", "static", "if", "else", "elif", "while", "foreach", "for", "do", "loop", "break", "continue", "return", "yield", "match",
+				"switch", "case", "default", "try", "catch", "finally", "throw", "in", "is", "as" };
+			const int count = 100000;
+			string text;
+			for (int i = 0; i < count; i++) {
+				text += keywords[(i * 7) % keywords.size()] + " ";
+			}
+			for (const bool trie : { true, false }) {
+				const _sp<RuleLibrary> library = make_shared<RuleLibrary>();
+				_sp_vec<Rule> each;
+				for (const string& keyword : keywords) {
+					each.push_back(EQ(keyword));
+				}
+				library->addSymbol("keyword", trie ? EQ(keywords) : OR(each));
+				library->addSymbol("space", REP(1, 0, EQ(' ')));
+				library->freeze();
+				out << measure(string("evaluationStrategies, ") + (trie ? "trie of " : "or of ") + to_string(keywords.size()) + " keywords", [&]() {
+					return parseText(library, evaluator::evaluationStrategies(), text);
+				}, 3);
+			}
+		}
+
+		/// <summary>
+		/// A run of symbols matched by one alternative that then fails, and matched again by the next,
+		/// so the cost of the nodes made and thrown away is what is measured, with them made as evaluation goes, and deferred.
+		/// </summary>
+		static void runBacktrackBenchmarks(std::ostream& out) {
+			const _sp<RuleLibrary> library = make_shared<RuleLibrary>();
+			library->addSymbol("a", EQ('a'));
+			library->addSymbol("as", OR({ SEQ(REP(RULE("a")), EQ('!')), SEQ(REP(RULE("a")), EQ(',')), SEQ(REP(RULE("a")), EQ(';')) }));
+			library->freeze();
+			const int count = 10000;
+			const string text = string(count, 'a') + ";";
+			for (const bool defer : { false, true }) {
+				size_t nodes = 0;
+				out << measure(string(defer ? "deferredStrategies" : "evaluationStrategies") + ", third choice of " + to_string(count), [&]() {
+					std::istringstream in(text);
+					const _sp<LocationSupplier> tokens = make_shared<LocationSupplier>(std::static_pointer_cast<Supplier<int>>(make_shared<StreamCharSupplier>(in)));
+					const auto strategies = defer ? deferred::deferredStrategies() : evaluator::evaluationStrategies();
+					const auto visitor = make_shared<evaluator::EvaluationVisitor>(library, strategies);
+					const evaluator::Output output = visitor->begin(evaluator::Input(tokens));
+					nodes = output.getNodes().at(0)->getChildren().size();
+					return static_cast<size_t>(output.idx);
+				}, 3);
+				if (nodes != static_cast<size_t>(count)) {
+					out << "    expected " << count << " nodes, got " << nodes << "\n";
+				}
+			}
+		}
+
+		/// <summary>
+		/// Expressions over three tiers of operators, matched by one OPERATORS rule, and by the grammar it stands for, a part per tier,
+		/// so what every operand costs in walking down through the tiers is what is measured, by time and by how many rules were visited.
+		/// </summary>
+		static void runOperatorBenchmarks(std::ostream& out) {
+			const int count = 20000;
+			const string symbols = "+*-^/";
+			string text;
+			for (int i = 0; i < count; i++) {
+				for (int operand = 0; operand < 16; operand++) {
+					text += (operand > 0 ? string(1, symbols[(i + operand) % symbols.size()]) : "") + to_string((i * 31 + operand * 7) % 1000);
+				}
+				text += " ";
+			}
+			for (const bool operators : { true, false }) {
+				const _sp<RuleLibrary> library = make_shared<RuleLibrary>();
+				library->addSymbol("number", REP(1, 0, DIGIT()));
+				if (operators) {
+					library->addSymbol("expression", OPERATORS(RULE("number"), { LEFT("sum", 1, EQ({ '+', '-' })), LEFT("product", 2, EQ({ '*', '/' })), RIGHT("power", 3, EQ('^')) }));
+				}
+				else {
+					library->addPart("sum", SEQ(RULE("product"), REP(SEQ(EQ({ '+', '-' }), RULE("product")))));
+					library->addPart("product", SEQ(RULE("power"), REP(SEQ(EQ({ '*', '/' }), RULE("power")))));
+					library->addPart("power", SEQ(RULE("number"), OPT(SEQ(EQ('^'), RULE("power")))));
+					library->addSymbol("expression", RULE("sum"));
+				}
+				library->addSymbol("space", REP(1, 0, EQ(' ')));
+				library->freeze();
+				const string name = operators ? "operators" : "tiers";
+				size_t parsed = 0;
+				_sp<Strategies<evaluator::Input, evaluator::Output>> strategies;
+				out << measure("evaluationStrategies, " + name + ", " + to_string(count) + " expressions", [&]() {
+					strategies = evaluator::evaluationStrategies();
+					parsed = parseText(library, strategies, text);
+					return parsed;
+				}, 3);
+				const auto caching = visitor::findStrategies<history::CachingStrategies<evaluator::Input, evaluator::Output, evaluator::Key>>(strategies);
+				out << "    " << caching->getMemo()->getStats().visits << " rules visited\n";
+				if (parsed != text.size()) {
+					out << "    expected " << text.size() << " characters, got " << parsed << "\n";
+				}
+				out << measure("deferredStrategies, " + name + ", " + to_string(count) + " expressions", [&]() {
+					return parseText(library, deferred::deferredStrategies(), text);
+				}, 3);
+			}
+		}
+
+		/// <summary>
+		/// Calls f with every node under the roots, depth first.
+		/// </summary>
+		template<typename F>
+		static void forEachSyntaxNode(const _sp_vec<SyntaxNode>& roots, F f) {
+			std::vector<const SyntaxNode*> pending;
+			for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+				pending.push_back(root->get());
+			}
+			while (!pending.empty()) {
+				const SyntaxNode* node = pending.back();
+				pending.pop_back();
+				f(*node);
+				const _sp_vec<SyntaxNode>& children = node->getChildren();
+				for (auto child = children.rbegin(); child != children.rend(); ++child) {
+					pending.push_back(child->get());
+				}
+			}
+		}
+
+		/// <summary>
+		/// Roughly what a SyntaxNode costs, the node and its range each shared with the allocator's header, its children and any type name too long to keep in place.
+		/// </summary>
+		static size_t syntaxNodeBytes(const SyntaxNode& node) {
+			const size_t allocatorHeader = 16;
+			const size_t shared = 2 * sizeof(void*) + allocatorHeader;
+			size_t bytes = shared + sizeof(SyntaxNode) + node.getChildren().capacity() * sizeof(_sp<SyntaxNode>);
+			if (node.getRange()) {
+				bytes += shared + sizeof(Range);
+			}
+			if (node.getType().capacity() > string().capacity()) {
+				bytes += node.getType().capacity() + 1 + allocatorHeader;
+			}
+			return bytes;
+		}
+
+		/// <summary>
+		/// The nodes the machine makes for the whole source, walked as SyntaxNodes, and again once copied into a SyntaxTree, with the bytes each takes.
+		/// </summary>
+		static void runTreeBenchmarks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			const auto strategies = machine::machineStrategies(library);
+			_sp<LocationSupplier> locations = std::make_shared<LocationSupplier>(source);
+			_sp<evaluator::EvaluationVisitor> visitor = std::make_shared<evaluator::EvaluationVisitor>(library, strategies);
+			_sp_vec<SyntaxNode> roots;
+			while (true) {
+				visitor->clear();
+				strategies->clear();
+				evaluator::Input input = evaluator::Input(locations);
+				evaluator::Output output = visitor->begin(input);
+				if (output.isFailure() || output.idx == input.idx) {
+					if (locations->isEnd(input.idx)) {
+						break;
+					}
+					locations->popRange(1);
+				}
+				else {
+					output.forEachNode([&](const _sp<SyntaxNode>& node) { roots.push_back(node); });
+				}
+			}
+
+			size_t nodeBytes = 0;
+			forEachSyntaxNode(roots, [&](const SyntaxNode& node) { nodeBytes += syntaxNodeBytes(node); });
+			out << "Syntax trees over " << fileName << "\n";
+			out << measure("SyntaxNode walk", [&]() {
+				size_t characters = 0;
+				forEachSyntaxNode(roots, [&](const SyntaxNode& node) {
+					characters += node.getRange() ? node.getRange()->size() : 0;
+				});
+				return characters;
+			});
+			SyntaxTree tree;
+			out << measure("SyntaxTree from SyntaxNodes", [&]() {
+				tree.clear();
+				for (const _sp<SyntaxNode>& root : roots) {
+					tree.add(*root);
+				}
+				return tree.size();
+			});
+			out << measure("SyntaxTree walk", [&]() {
+				size_t characters = 0;
+				for (SyntaxTree::Handle node = 0; node < static_cast<SyntaxTree::Handle>(tree.size()); node++) {
+					characters += tree.getStart(node) == SyntaxTree::NO_POSITION ? 0 : tree.getEnd(node) - tree.getStart(node);
+				}
+				return characters;
+			});
+			out << measure("SyntaxTree cursor walk", [&]() {
+				size_t characters = 0;
+				for (SyntaxTree::Cursor cursor = tree.cursor(); cursor.isValid(); cursor.gotoNext()) {
+					characters += cursor.getStart() == SyntaxTree::NO_POSITION ? 0 : cursor.getEnd() - cursor.getStart();
+				}
+				return characters;
+			});
+			out << std::fixed << std::setprecision(1) << tree.size() << " nodes, SyntaxNodes ~" << static_cast<double>(nodeBytes) / tree.size()
+				<< " bytes per node, SyntaxTree " << static_cast<double>(tree.memoryBytes()) / tree.size() << " bytes per node\n";
+		}
+
+		/// <summary>
+		/// Roughly what a RuleHistories record costs, a map node and a shared record, each with the allocator's header.
+		/// </summary>
+		template<typename STORE>
+		static size_t historyRecordBytes() {
+			const size_t allocatorHeader = 16;
+			const size_t mapNode = 4 * sizeof(void*) + sizeof(std::pair<const int, _sp<history::HistoryRecord<STORE>>>);
+			const size_t sharedRecord = 2 * sizeof(void*) + sizeof(history::HistoryRecord<STORE>);
+			return mapNode + sharedRecord + 2 * allocatorHeader;
+		}
+
+		/// <summary>
+		/// Lookups per second through the memo table, and through the map of maps it replaced, with the bytes each holds per character.
+		/// Every rule in the library is looked up at every position, completed, then looked up again, the way a packrat parse comes back to them.
+		/// </summary>
+		static void runMemoBenchmarks(_sp<RuleLibrary> library, const string fileName, std::ostream& out) {
+			using evaluator::Output;
+			const _sp<MappedSource> source = std::make_shared<MappedSource>(fileName);
+			const int positions = static_cast<int>(source->size());
+			std::vector<int> ruleIds;
+			for (const string& name : library->getSymbolNames()) {
+				ruleIds.push_back(library->getSymbol(name)->id);
+			}
+			for (const string& name : library->getPartNames()) {
+				ruleIds.push_back(library->getPart(name)->id);
+			}
+			const size_t lookups = 2 * ruleIds.size() * positions;
+			out << "Memo tables over " << positions << " positions, " << ruleIds.size() << " rules\n";
+
+			// what each policy costs the evaluator, whose table is cleared after each symbol, before the tables below churn the heap.
+			std::vector<_sp<history::MemoPolicy>> policies = { history::memoiseAll(), history::memoiseProductions(), history::memoiseSymbols() };
+			for (const auto mode : { history::MemoMode::All, history::MemoMode::Productions }) {
+				policies.push_back(make_shared<history::MemoPolicy>(mode));
+				policies.back()->adapt();
+			}
+			for (const auto& policy : policies) {
+				_sp<Strategies<evaluator::Input, Output>> strategies;
+				const string adaptive = policy->isAdaptive() ? ", adaptive" : "";
+				out << measure("evaluationStrategies, memoise " + history::MemoPolicy::modeName(policy->getMode()) + adaptive, [&]() {
+					strategies = evaluator::evaluationStrategies(policy);
+					return parseAll(library, strategies, source);
+				}, 1);
+				const auto caching = visitor::findStrategies<history::CachingStrategies<evaluator::Input, Output, evaluator::Key>>(strategies);
+				const history::MemoStats& stats = caching->getMemo()->getStats();
+				out << std::setprecision(1) << "    " << stats.visits << " visits, " << stats.transient << " transient, " << stats.guarded << " guarded, "
+					<< 100 * stats.hitRate() << "% hit, " << stats.stored << " stored, peaked at " << stats.peakEntries << " entries, " << stats.peakBytes << " bytes\n";
+				if (policy->isAdaptive()) {
+					const history::AdaptationStats& adapted = policy->getAdaptationStats();
+					out << "    switched off " << adapted.switchedOff << " times, back on " << adapted.switchedOn << ", "
+						<< adapted.offVisits << " visits while off, " << policy->getSwitchedOff().size() << " productions off at the end\n";
+				}
+			}
+
+			size_t memoBytes = 0;
+			out << measure("MemoTable", [&]() {
+				history::MemoTable<Output> memo;
+				size_t found = 0;
+				for (int position = 0; position < positions; position++) {
+					for (const int ruleId : ruleIds) {
+						if (memo.lookup(ruleId, position).state == history::RuleHistoryState::New) {
+							memo.setCompleted(ruleId, position, Output(position + 1));
+						}
+					}
+				}
+				for (int position = 0; position < positions; position++) {
+					for (const int ruleId : ruleIds) {
+						found += memo.lookup(ruleId, position).state == history::RuleHistoryState::Completed;
+					}
+				}
+				memoBytes = memo.memoryBytes();
+				return found + memo.size();
+			}, 3);
+
+			size_t records = 0;
+			out << measure("RuleHistories", [&]() {
+				history::RuleHistories<int, Output> histories;
+				size_t found = 0;
+				for (int position = 0; position < positions; position++) {
+					for (const int ruleId : ruleIds) {
+						auto record = histories.getRecords(ruleId)->getRecord(position);
+						if (!record->isCompleted()) {
+							record->setCompleted(Output(position + 1));
+						}
+					}
+				}
+				for (int position = 0; position < positions; position++) {
+					for (const int ruleId : ruleIds) {
+						found += histories.getRecords(ruleId)->getRecord(position)->isCompleted();
+					}
+				}
+				records = ruleIds.size() * positions;
+				return found + records;
+			}, 3);
+
+			out << std::fixed << std::setprecision(1)
+				<< "MemoTable " << static_cast<double>(memoBytes) / positions << " bytes per character, "
+				<< "RuleHistories ~" << static_cast<double>(records * historyRecordBytes<Output>()) / positions << " bytes per character, "
+				<< lookups << " lookups each\n";
+
+		}
+	}
+}
+#endif
@@ -19,16 +19,26 @@
 
 #include "Util.h"
 #include "Supplier.h"
-#include <deque>
+#include "SlidingWindow.h"
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 namespace flock {
 	namespace supplier {
 
+		/// <summary>
+		/// Keeps what has been supplied until it is popped, indexes are relative to the first element not yet popped.
+		/// Popped elements are held in a sliding window until there are enough to be worth letting go of.
+		///
+		/// Elements are pulled a block at a time through supplyInto, whose default stops after the first unless isAvailable() says the next is to hand.
+		/// A subclass that holds its elements should say so, or override supplyInto, otherwise it is pulled one element per call, which only suits interactive input.
+		/// The BoxedCharSupplier of the benchmarks, the only one here, says so.
+		/// </summary>
 		template<typename Contents, typename R = _sp_vec<Contents>>
 		class CachedSupplier : public  Supplier<_sp<Contents>> {
 		public:
+			CachedSupplier(const size_t maxWindow = SlidingWindow<_sp<Contents>>::UNBOUNDED) : store(maxWindow) {}
 
 			virtual R pollRange(const int amount = 1, const int startIdx = 0) {
 				return pollRangeBetween(startIdx, startIdx+amount);
@@ -52,23 +62,31 @@ namespace flock {
 				if (idx < 0) {
 					return nullptr;
 				}
-				for (int i = store.size(); i <= idx; i++) {
-					auto value = this->supply();
-					if (!value) {
-						return nullptr;
+				const int position = store.getCommitted() + idx;
+				if (position >= store.getEnd()) {
+					store.release();
+				}
+				while (position >= store.getEnd()) {
+					// pull in a block at a time, but no more than the window has room for.
+					const int needed = position - store.getEnd() + 1;
+					const int wanted = std::max(needed, static_cast<int>(std::min<size_t>(BLOCK_SIZE, store.room())));
+					if (static_cast<int>(block.size()) < wanted) {
+						block.resize(wanted);
 					}
-
-					store.push_back(value);
-					// why bother looking up if we have fetched it.
-					if (i == idx) {
-						return value;
+					const int count = this->supplyInto(block.data(), wanted);
+					if (count == 0) {
+						return nullptr;
 					}
+					store.append(block.data(), count);
+					// don't hold on to what is now in the store.
+					std::fill(block.begin(), block.begin() + count, nullptr);
 				}
-				return store.at(idx);
+				return store.at(position);
 			};
 
 			_sp<Contents> pop() {
-				if (store.empty()) {
+				const int next = store.getCommitted();
+				if (next >= store.getEnd()) {
 					auto value = this->supply();
 					if (!value) {
 						return nullptr;
@@ -77,26 +95,35 @@ namespace flock {
 					return value;
 				}
 				else {
-					auto value = store.front();
-					store.pop_front();
+					auto value = store.at(next);
+					store.commit(next + 1);
 					return value;
 				}
 			};
 
 			R popRange(const int amount = 1) {
 				auto range = pollRange(amount);
-				if (amount > 0 && !store.empty()) {
-					store.erase(store.begin(), min(store.begin() + amount, store.end()));
+				if (amount > 0) {
+					store.commit(store.getCommitted() + amount);
 				}
 				return range;
 			};
+
+			WindowStats getWindowStats() const {
+				return store.getStats();
+			}
 		protected:
-			std::deque<_sp<Contents>> store;
+			static const int BLOCK_SIZE = 64;
+
+			SlidingWindow<_sp<Contents>> store;
+			std::vector<_sp<Contents>> block;
 		};
 
 		template<typename Contents>
 		class CachedVectorSupplier : public CachedSupplier<Contents> {
 		public:
+			using CachedSupplier<Contents>::CachedSupplier;
+
 			virtual _sp_vec<Contents> pollRangeBetween(const int startIdx = 0, const int endIdx = 1) override {
 				_sp_vec<Contents> vecStore;
 				for (int nextId = startIdx; nextId < endIdx; nextId++) {
@@ -19,6 +19,8 @@
 #include "Supplier.h"
 #include <iostream>
 #include <string>
+#include <cstdio>
+#include <algorithm>
 
 namespace flock {
 	using namespace std;
@@ -57,6 +59,36 @@ namespace flock {
 					return '\n';
 				}
 			}
+
+			/// <summary>
+			/// The rest of the line, and its line break, have been read already, only the next line has to be waited for.
+			/// </summary>
+			bool isAvailable() override {
+				return !inputComplete && pos <= size;
+			}
+
+			/// <summary>
+			/// Hands back the rest of the current line, rather than wait on the next one.
+			/// </summary>
+			int supplyInto(int* into, const int amount) override {
+				if (amount <= 0) {
+					return 0;
+				}
+				const int first = ConsoleCharSupplier::supply();
+				if (first == EOF) {
+					return 0;
+				}
+				int count = 0;
+				into[count++] = first;
+				while (count < amount && pos < size) {
+					into[count++] = line.at(pos++);
+				}
+				if (count < amount && pos == size) {
+					pos++;
+					into[count++] = '\n';
+				}
+				return count;
+			}
 			std::string line;
 			int pos = 0;
 			int size = -1;
@@ -64,6 +96,48 @@ namespace flock {
 			const string end;
 		};
 
+		/// <summary>
+		/// Supplies the characters of a stream through to its end, such as piped standard input.
+		/// </summary>
+		class StreamCharSupplier : public Supplier <int> {
+		public:
+			StreamCharSupplier(std::istream& stream) : buffer(stream.rdbuf()) {}
+
+			int supply() override {
+				const int c = buffer->sbumpc();
+				return c == std::char_traits<char>::eof() ? EOF : static_cast<unsigned char>(c);
+			}
+
+			/// <summary>
+			/// Whatever the stream has buffered, which for a string stream is all of it.
+			/// </summary>
+			bool isAvailable() override {
+				return buffer->in_avail() > 0;
+			}
+
+			/// <summary>
+			/// Waits for at least one character, then only takes what the stream already has buffered.
+			/// </summary>
+			int supplyInto(int* into, const int amount) override {
+				if (amount <= 0) {
+					return 0;
+				}
+				const int first = supply();
+				if (first == EOF) {
+					return 0;
+				}
+				into[0] = first;
+				const std::streamsize buffered = buffer->in_avail();
+				const int count = 1 + static_cast<int>(std::min<std::streamsize>(amount - 1, std::max<std::streamsize>(0, buffered)));
+				for (int i = 1; i < count; i++) {
+					into[i] = static_cast<unsigned char>(buffer->sbumpc());
+				}
+				return count;
+			}
+		protected:
+			std::streambuf* buffer;
+		};
+
 	}
 }
 #endif
\ No newline at end of file
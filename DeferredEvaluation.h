@@ -0,0 +1,397 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_DEFERRED_EVALUATION_H
+#define FLOCK_COMPILER_DEFERRED_EVALUATION_H
+
+#include "Util.h"
+#include "Rules.h"
+#include "LogicRules.h"
+#include "StringRules.h"
+#include "RuleHistory.h"
+#include "SourceEvaluation.h"
+#include "SyntaxTree.h"
+#include "SyntaxEvents.h"
+#include <string>
+#include <vector>
+
+ ///
+ /// Evaluates the library without making any syntax nodes, only noting where each rule that can carry them matched.
+ /// Once a symbol has won, its tree is rebuilt from those matches, down the winning path alone,
+ /// so whatever was matched and then backtracked over, or only looked ahead at, costs a table entry rather than nodes and ranges.
+ ///
+namespace flock {
+	namespace rule {
+		using namespace std;
+		using namespace types;
+		namespace deferred {
+			using namespace evaluator;
+
+			/// <summary>
+			/// Where each rule matched, by rule and start, cleared along with the memo table, after every top level symbol.
+			/// </summary>
+			using Matches = MemoTable<int>;
+
+			/// <summary>
+			/// Notes the end of every success of the rule it wraps.
+			/// </summary>
+			class RecordingRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				RecordingRuleStrategy(_sp<Matches> matches, _sp<RuleStrategy<Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped), matches(matches) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					Output output = wrapped->accept(visitor, baseRule, input);
+					if (output.isSuccess()) {
+						matches->setCompleted(baseRule->id, input.idx, output.idx);
+					}
+					return output;
+				}
+
+			protected:
+				_sp<Matches> matches;
+			};
+
+			/// <summary>
+			/// Records the rules that can carry syntax nodes, anything else is evaluated again if the tree needs to know where it ended.
+			/// </summary>
+			class RecordingStrategies : public types::WrappingStrategies<Input, Output> {
+			public:
+				RecordingStrategies(_sp<types::Strategies<Input, Output>> strategies, _sp<Matches> matches) : types::WrappingStrategies<Input, Output>(strategies), matches(matches) {}
+
+				static bool isRecorded(const int type) {
+					switch (type) {
+					case LogicRules::Alias:
+					case LogicRules::Sequence:
+					case LogicRules::Or:
+					case LogicRules::XOr:
+					case LogicRules::And:
+					case LogicRules::Optional:
+					case LogicRules::Repeat:
+					case LogicRules::Operators:
+						return true;
+					default:
+						return false;
+					}
+				}
+
+				virtual void addStrategy(const int type, _sp<RuleStrategy<Input, Output>> strategy) override {
+					if (isRecorded(type)) {
+						getWrappedStratagies()->addStrategy(type, make_shared<RecordingRuleStrategy>(matches, strategy));
+						return;
+					}
+					getWrappedStratagies()->addStrategy(type, strategy);
+				}
+
+				_sp<Matches> getMatches() {
+					return matches;
+				}
+
+				virtual void clear() override {
+					matches->clear();
+					types::WrappingStrategies<Input, Output>::clear();
+				}
+
+			protected:
+				_sp<Matches> matches;
+			};
+
+			/// <summary>
+			/// Rebuilds the nodes under a match, following the rules down the way evaluation went, and asking the matches where each ended.
+			/// Nothing it is asked about is evaluated twice, bar the rules that are never recorded, which carry no nodes, and are mostly single characters.
+			/// </summary>
+			class TreeReplay {
+			public:
+				TreeReplay(_sp<EvaluationVisitor> visitor, _sp<Matches> matches, Tokens tokens, SyntaxTree& tree, _sp<CharacterSpans> spans = nullptr) : visitor(visitor), matches(matches), tokens(tokens), tree(tree), spans(spans) {}
+
+				/// <summary>
+				/// Adds the nodes rule made at position to the tree, under the node still open, and gives where it ended, or -1 if it didn't match.
+				/// </summary>
+				int replay(const _sp<Rule>& rule, const int position) {
+					const int end = endOf(rule, position);
+					if (end < 0 || !RecordingStrategies::isRecorded(rule->type)) {
+						return end;
+					}
+					switch (rule->type) {
+					case LogicRules::Alias:
+						replayAlias(visitor::nodeAs<AliasRule>(rule), position, end);
+						break;
+					case LogicRules::Sequence:
+						replaySequence(visitor::nodeAs<CollectionRule>(rule).getChildren(), position, end);
+						break;
+					case LogicRules::Or:
+					case LogicRules::XOr:
+						// an exclusive or that matched had only the one success, so for both it is the first.
+						replayFirst(visitor::nodeAs<CollectionRule>(rule).getChildren(), position, end);
+						break;
+					case LogicRules::And:
+						// only the first child's output is kept, the rest are just checked.
+						expect(replay(visitor::nodeAs<CollectionRule>(rule).getChildren().at(0), position), end, rule);
+						break;
+					case LogicRules::Optional: {
+						const int ended = replay(visitor::nodeAs<UnaryRule>(rule).getChild(), position);
+						if (ended >= 0) {
+							expect(ended, end, rule);
+						}
+						break;
+					}
+					case LogicRules::Repeat: {
+						RepeatRule& repeat = visitor::nodeAs<RepeatRule>(rule);
+						// scanned in one go, there is nothing under it.
+						if (spans && spans->of(visitor->getLibrary(), repeat)) {
+							break;
+						}
+						const _sp<Rule>& child = repeat.getChild();
+						int at = position;
+						while (at < end) {
+							const int next = replay(child, at);
+							if (next <= at) {
+								throw string("Unable to rebuild the repeat of rule " + to_string(rule->id) + " at position " + to_string(at));
+							}
+							at = next;
+						}
+						expect(at, end, rule);
+						break;
+					}
+					case LogicRules::Operators:
+						replayOperators(visitor::nodeAs<OperatorsRule>(rule), position, end);
+						break;
+					}
+					return end;
+				}
+
+				/// <summary>
+				/// A node for the symbol name, matched between start and end, with everything under it.
+				/// </summary>
+				void replaySymbol(const string& name, const _sp<Rule>& rule, const int start, const int end) {
+					open(name, start);
+					expect(replay(rule, start), end, rule);
+					tree.close(end);
+				}
+
+			protected:
+				/// <summary>
+				/// Where rule ended, when it started at position, -1 if it didn't match.
+				/// </summary>
+				int endOf(const _sp<Rule>& rule, const int position) {
+					if (RecordingStrategies::isRecorded(rule->type)) {
+						const MemoEntry* entry = matches->find(rule->id, position);
+						return entry && entry->state == RuleHistoryState::Completed ? matches->getCompleted(*entry) : -1;
+					}
+					return visitor->visit(rule, Input(tokens, position)).idx;
+				}
+
+				void replayAlias(AliasRule& rule, const int position, const int end) {
+					bool isSymbol = rule.isBound() && rule.isSymbol();
+					_sp<Rule> target = rule.isBound() ? rule.getTarget() : nullptr;
+					if (!target) {
+						target = visitor->getSymbol(rule.getAlias());
+						isSymbol = target != nullptr;
+						if (!isSymbol) {
+							target = visitor->getPart(rule.getAlias());
+						}
+					}
+					if (!target) {
+						return;
+					}
+					if (isSymbol) {
+						replaySymbol(rule.getAlias(), target, position, end);
+					}
+					else {
+						expect(replay(target, position), end, target);
+					}
+				}
+
+				void replaySequence(const _sp_vec<Rule>& children, const int position, const int end) {
+					int at = position;
+					for (const _sp<Rule>& child : children) {
+						at = replay(child, at);
+						if (at < 0) {
+							throw string("Unable to rebuild the sequence at position " + to_string(position) + ", rule " + to_string(child->id) + " did not match");
+						}
+					}
+					if (at != end) {
+						throw string("Unable to rebuild the sequence at position " + to_string(position) + ", it ended at " + to_string(at) + " rather than " + to_string(end));
+					}
+				}
+
+				void replayFirst(const _sp_vec<Rule>& children, const int position, const int end) {
+					for (const _sp<Rule>& child : children) {
+						const int ended = replay(child, position);
+						if (ended >= 0) {
+							expect(ended, end, child);
+							return;
+						}
+					}
+				}
+
+				/// <summary>
+				/// Follows the chain the way evaluation matched it, then replays it again with the node of each operator opened before the first operand it joins,
+				/// and closed after the last, outermost first.
+				/// </summary>
+				void replayOperators(OperatorsRule& rule, const int position, const int end) {
+					const _sp_vec<Rule>& children = rule.getChildren();
+					const _sp<Rule>& operand = children.front();
+					// where each operand starts and ends, and which operator is between each and the next.
+					vector<int> starts = { position };
+					vector<int> ends = { endOf(operand, position) };
+					vector<int> matched;
+					while (ends.back() >= 0 && ends.back() < end) {
+						int next = -1;
+						for (size_t i = 1; i < children.size() && next < 0; i++) {
+							next = endOf(children[i], ends.back());
+							if (next >= 0) {
+								matched.push_back(static_cast<int>(i) - 1);
+							}
+						}
+						if (next < 0) {
+							break;
+						}
+						starts.push_back(next);
+						ends.push_back(endOf(operand, next));
+					}
+					if (ends.back() != end) {
+						throw string("Unable to rebuild the operators at position " + to_string(position) + ", they ended at " + to_string(ends.back()) + " rather than " + to_string(end));
+					}
+					vector<vector<int>> opens(starts.size());
+					vector<int> closes(starts.size(), 0);
+					for (const OperatorsRule::Fold& fold : rule.fold(matched)) {
+						opens[fold.first].push_back(fold.op);
+						closes[fold.last]++;
+					}
+					for (size_t i = 0; i < starts.size(); i++) {
+						// folded tightest first, so the outermost was the last to be added.
+						for (auto op = opens[i].rbegin(); op != opens[i].rend(); ++op) {
+							open(rule.getOperators()[matched[*op]].name, starts[i]);
+						}
+						expect(replay(operand, starts[i]), ends[i], operand);
+						for (int closed = 0; closed < closes[i]; closed++) {
+							tree.close(ends[i]);
+						}
+						if (i + 1 < starts.size()) {
+							expect(replay(children[matched[i] + 1], ends[i]), starts[i + 1], children[matched[i] + 1]);
+						}
+					}
+				}
+
+				void open(const string& name, const int start) {
+					tree.open(tree.typeId(name), tokens->isEnd(start) ? SyntaxTree::NO_POSITION : start);
+				}
+
+				void expect(const int ended, const int end, const _sp<Rule>& rule) {
+					if (ended != end) {
+						throw string("Unable to rebuild rule " + to_string(rule->id) + ", it ended at " + to_string(ended) + " rather than " + to_string(end));
+					}
+				}
+
+				_sp<EvaluationVisitor> visitor;
+				_sp<Matches> matches;
+				Tokens tokens;
+				SyntaxTree& tree;
+				_sp<CharacterSpans> spans;
+			};
+
+			/// <summary>
+			/// Tries every symbol and keeps the longest, the same as the EvaluationLibraryStrategy, then rebuilds the nodes for that one alone.
+			/// Given a consumer, they are sent to it as events instead, and the output carries no nodes.
+			/// </summary>
+			class DeferredLibraryStrategy : public LibraryStrategy<Input, Output> {
+			public:
+				DeferredLibraryStrategy(_sp<Matches> matches, _sp<SyntaxConsumer> consumer = nullptr, _sp<FirstSetPruning> pruning = nullptr, _sp<CharacterSpans> spans = nullptr) :
+					matches(matches), consumer(consumer), pruning(pruning), spans(spans) {}
+
+				virtual Output accept(_sp<EvaluationVisitor> visitor, _sp<RuleLibrary> library, Input input) override {
+					vector<string> symbolNames = library->getSymbolNames();
+					Output out = FAILURE;
+					string name = "";
+					const int character = input.tokens->poll(input.idx);
+
+					for (auto rule = symbolNames.begin(); rule != symbolNames.end(); ++rule) {
+						try {
+							const _sp<Rule> symbol = library->getSymbol(*rule);
+							if (pruning && symbol && !pruning->canStart(library, *symbol, input.idx, character)) {
+								continue;
+							}
+							Output newOut = visitor->visitSymbol(*rule, symbol, input);
+							if (newOut.idx > out.idx) {
+								name = *rule;
+								out = newOut;
+							}
+						}
+						catch (string exc) {
+							cout << "\nexception was thrown: " << exc << "\n";
+						}
+					}
+					if (out.isFailure()) {
+						return out;
+					}
+					tree.clear();
+					tree.setText(input.tokens);
+					TreeReplay replay(visitor, matches, input.tokens, tree, spans);
+					replay.replaySymbol(name, library->getSymbol(name), input.idx, out.idx);
+					if (consumer) {
+						// sent before the range is popped, so the consumer can still look at the text.
+						emitEvents(tree, tree.getFirstRoot(), *consumer);
+						input.tokens->popRange(out.idx - input.idx);
+						return Output(out.idx);
+					}
+					input.tokens->popRange(out.idx - input.idx);
+					return Output(out.idx, tree.toNode(tree.getFirstRoot()));
+				}
+
+				/// <summary>
+				/// The tree of the last symbol matched, for anything that would rather walk that than the nodes.
+				/// </summary>
+				const SyntaxTree& getTree() const {
+					return tree;
+				}
+
+			protected:
+				_sp<Matches> matches;
+				_sp<SyntaxConsumer> consumer;
+				_sp<FirstSetPruning> pruning;
+				_sp<CharacterSpans> spans;
+				SyntaxTree tree;
+			};
+
+			/// <summary>
+			/// Walks the rules like evaluationStrategies(), with the same nodes in the end, but only makes them for the symbols that win.
+			/// With a consumer the nodes are never made at all, each symbol that wins is sent to it as events.
+			/// A rule skipped for its first set is never recorded, so it is rebuilt as not having matched, which it couldn't have.
+			/// A repeat matched with a scan has nothing under it to rebuild.
+			/// </summary>
+			static _sp<types::Strategies<Input, Output>> deferredStrategies(_sp<MemoPolicy> policy = memoiseProductions(), _sp<SyntaxConsumer> consumer = nullptr,
+				_sp<FirstSetPruning> pruning = make_shared<FirstSetPruning>(), _sp<CharacterSpans> spans = make_shared<CharacterSpans>()) {
+				auto matches = make_shared<Matches>();
+				auto baseStrategies = make_shared<BaseStrategies<Input, Output>>();
+				auto strategies = pruneWith(spanWith(cache<Input, Output, Key>(make_shared<RecordingStrategies>(baseStrategies, matches), policy, evaluationMixins), spans), pruning);
+				addLogicStrategies<Input, Output>(evaluationMixins, strategies);
+				strategies->setLibraryStrategy(make_shared<DeferredLibraryStrategy>(matches, consumer, pruning, spans));
+				strategies->addStrategy(StringRules::EqualChar, make_shared<HasCharRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::EqualString, make_shared<StringRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::CharRange, make_shared<CharRangeRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::CharClass, make_shared<CharClassRuleStrategy>(evaluationMixins));
+				return strategies;
+			}
+
+			/// <summary>
+			/// Sends each symbol that wins to the consumer as events, once it can no longer be backtracked over, without the tree for the whole source ever being built.
+			/// </summary>
+			static _sp<types::Strategies<Input, Output>> streamingStrategies(_sp<SyntaxConsumer> consumer, _sp<MemoPolicy> policy = memoiseProductions()) {
+				return deferredStrategies(policy, consumer);
+			}
+		}
+	}
+}
+#endif
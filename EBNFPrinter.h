@@ -20,6 +20,7 @@
 #include "LogicRules.h"
 #include "StringRules.h"
 #include "ConsoleFormat.h"
+#include <cstdio>
 
 namespace flock {
 	namespace rule {
@@ -56,20 +57,19 @@ namespace flock {
 				};
 
 				template<typename T>
-				class PrintEquals : public RuleStrategy<Input, Output> {
+				class PrintEquals : public TypedRuleStrategy<Input, Output, ValuesRule<T>, PrintEquals<T>> {
 				public:
 					PrintEquals() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<ValuesRule<T>>(baseRule);
-						const vector<T> values = rule->getValues();
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, ValuesRule<T>& rule, const Input& bracketHints) {
+						const vector<T>& values = rule.getValues();
 						const bool shouldBracket = values.size() > 1 && bracketHints.collectionType != LogicRules::Or && !bracketHints.parentBracketed;
 						bool first = true;
 						string collected;
 						if (shouldBracket) {
 							collected += "(";
 						}
-						for (auto value : values) {
+						for (const auto& value : values) {
 							if (first) {
 								first = false;
 							}
@@ -142,13 +142,12 @@ namespace flock {
 				/// <summary>
 				/// EBNF does not have the concept of range, but its the same as alot of ORs
 				/// </summary>
-				class PrintRange : public RuleStrategy<Input, Output> {
+				class PrintRange : public TypedRuleStrategy<Input, Output, ValuesRule<int>, PrintRange> {
 				public:
 					PrintRange() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<ValuesRule<int>>(baseRule);
-						const vector<int> values = rule->getValues();
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, ValuesRule<int>& rule, const Input& bracketHints) {
+						const vector<int>& values = rule.getValues();
 						const int min = values.at(0);
 						const int max = values.at(1);
 						const bool shouldBracket = (max > min + 1) && bracketHints.collectionType != LogicRules::Or && !bracketHints.parentBracketed;
@@ -186,17 +185,65 @@ namespace flock {
 					}
 				};
 
+				/// <summary>
+				/// CharClass = ? FLOCK class [a-z_] ?, EBNF would need an alternative for every character.
+				/// </summary>
+				class PrintCharClass : public TypedRuleStrategy<Input, Output, CharClassRule, PrintCharClass> {
+				public:
+					PrintCharClass() {}
+
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, CharClassRule& rule, const Input& bracketHints) {
+						const bitset<256>& bytes = rule.getBytes();
+						string collected;
+						for (int start = 0; start < 256; start++) {
+							if (!bytes.test(start)) {
+								continue;
+							}
+							int end = start;
+							while (end + 1 < 256 && bytes.test(end + 1)) {
+								end++;
+							}
+							collected += getValue(start);
+							if (end > start) {
+								collected += (end > start + 1 ? "-" : "") + getValue(end);
+							}
+							start = end;
+						}
+						for (const pair<int, int>& range : rule.getCodePoints()) {
+							collected += getCodePoint(range.first);
+							if (range.second > range.first) {
+								collected += "-" + getCodePoint(range.second);
+							}
+						}
+						return colourize(Colour::DARK_CYAN, "? FLOCK class [") + colourize(Colour::RED, collected) + colourize(Colour::DARK_CYAN, "] ?");
+					}
+
+					string getValue(const int value) {
+						if (isgraph(value) || value == ' ') {
+							return (value == '-' || value == ']' || value == '\\' ? "\\" : "") + string(1, static_cast<char>(value));
+						}
+						char escaped[8];
+						snprintf(escaped, sizeof(escaped), "\\x%02X", value);
+						return escaped;
+					}
+
+					string getCodePoint(const int value) {
+						char escaped[16];
+						snprintf(escaped, sizeof(escaped), "\\u{%X}", value);
+						return escaped;
+					}
+				};
+
 				/// <summary>
 				///  Repeat = *A , 2*A, +A, 3+A, A{ *,5 }, A{ 2,6 }
 				/// </summary>
-				class PrintRepeat : public RuleStrategy<Input, Output> {
+				class PrintRepeat : public TypedRuleStrategy<Input, Output, RepeatRule, PrintRepeat> {
 				public:
-					PrintRepeat() : RuleStrategy<Input, Output>() {}
+					PrintRepeat() : TypedRuleStrategy<Input, Output, RepeatRule, PrintRepeat>() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<RepeatRule>(baseRule);
-						const int min = std::max(rule->getMin(), 0); // ensure negatives are 0;
-						const int max = std::max(rule->getMax(), 0);
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, RepeatRule& rule, const Input& bracketHints) {
+						const int min = std::max(rule.getMin(), 0); // ensure negatives are 0;
+						const int max = std::max(rule.getMax(), 0);
 						string prepend;
 						string postpend;
 						bool bracketed;
@@ -242,7 +289,7 @@ namespace flock {
 							bracketed = false;
 						}
 
-						const string collected = visitor->visit(rule->getChild(), BracketHints(bracketed, -1));
+						const string collected = visitor->visit(rule.getChild(), BracketHints(bracketed, -1));
 						return prepend + collected + postpend;
 
 					}
@@ -250,13 +297,12 @@ namespace flock {
 				/// <summary>
 				/// 	AnyBut = A<>
 				/// </summary>
-				class PrintAnyBut : public RuleStrategy<Input, Output> {
+				class PrintAnyBut : public TypedRuleStrategy<Input, Output, UnaryRule, PrintAnyBut> {
 				public:
-					PrintAnyBut() : RuleStrategy<Input, Output>() {}
+					PrintAnyBut() : TypedRuleStrategy<Input, Output, UnaryRule, PrintAnyBut>() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-						const string collected = visitor->visit(rule->getChild(), BracketHints(false, -1));
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, UnaryRule& rule, const Input& bracketHints) {
+						const string collected = visitor->visit(rule.getChild(), BracketHints(false, -1));
 						return colourize(Colour::DARK_CYAN, "? FLOCK anybut ") + collected + colourize(Colour::DARK_CYAN, " ?");
 					}
 				};
@@ -264,13 +310,12 @@ namespace flock {
 				/// <summary>
 				///		Not = A!
 				/// </summary>
-				class PrintNot : public RuleStrategy<Input, Output> {
+				class PrintNot : public TypedRuleStrategy<Input, Output, UnaryRule, PrintNot> {
 				public:
-					PrintNot() : RuleStrategy<Input, Output>() {}
+					PrintNot() : TypedRuleStrategy<Input, Output, UnaryRule, PrintNot>() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-						const string collected = visitor->visit(rule->getChild(), BracketHints(false, -1));
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, UnaryRule& rule, const Input& bracketHints) {
+						const string collected = visitor->visit(rule.getChild(), BracketHints(false, -1));
 						return colourize(Colour::DARK_CYAN, "? FLOCK not ") + collected + colourize(Colour::DARK_CYAN, " ?");
 					}
 				};
@@ -278,13 +323,12 @@ namespace flock {
 				/// <summary>
 				/// 	Optional = [A]
 				/// </summary>
-				class PrintOptional : public RuleStrategy<Input, Output> {
+				class PrintOptional : public TypedRuleStrategy<Input, Output, UnaryRule, PrintOptional> {
 				public:
-					PrintOptional() : RuleStrategy<Input, Output>() {}
+					PrintOptional() : TypedRuleStrategy<Input, Output, UnaryRule, PrintOptional>() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-						const string collected = visitor->visit(rule->getChild(), BracketHints(true, -1));
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, UnaryRule& rule, const Input& bracketHints) {
+						const string collected = visitor->visit(rule.getChild(), BracketHints(true, -1));
 						return "[" + collected + "]";
 					}
 				};
@@ -292,13 +336,12 @@ namespace flock {
 				/// <summary>
 				/// Alias = A
 				/// </summary>
-				class PrintAlias : public RuleStrategy<Input, Output> {
+				class PrintAlias : public TypedRuleStrategy<Input, Output, AliasRule, PrintAlias> {
 				public:
-					PrintAlias() : RuleStrategy<Input, Output>() {}
+					PrintAlias() : TypedRuleStrategy<Input, Output, AliasRule, PrintAlias>() {}
 
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<AliasRule>(baseRule);
-						return colourize(Colour::GREEN, rule->getAlias());
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, AliasRule& rule, const Input& bracketHints) {
+						return colourize(Colour::GREEN, rule.getAlias());
 					}
 				};
 
@@ -309,13 +352,12 @@ namespace flock {
 				///		And = A & B & C
 				///		XOr = A ^ B ^ C
 				/// </summary>
-				class PrintCollection : public RuleStrategy<Input, Output> {
+				class PrintCollection : public TypedRuleStrategy<Input, Output, CollectionRule, PrintCollection> {
 				public:
-					PrintCollection(const string seperator) : RuleStrategy<Input, Output>(), seperator(seperator) {}
-					virtual Output accept(_sp<PrintVisitor> visitor, _sp<Rule> baseRule, Input bracketHints) override {
-						const auto rule = std::dynamic_pointer_cast<CollectionRule>(baseRule);
-						const int type = (LogicRules)rule->type;
-						const bool aCollection = rule->getChildren().size() > 1;
+					PrintCollection(const string seperator) : TypedRuleStrategy<Input, Output, CollectionRule, PrintCollection>(), seperator(seperator) {}
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, CollectionRule& rule, const Input& bracketHints) {
+						const int type = (LogicRules)rule.type;
+						const bool aCollection = rule.getChildren().size() > 1;
 						// if we have one or less children, we aren't grouping anything
 						// if the parent is bracketed, or the collection type is the same, its clearer not use to brackets
 						const bool shouldBracket = aCollection && !(bracketHints.parentBracketed || type == bracketHints.collectionType);
@@ -325,14 +367,14 @@ namespace flock {
 						if (shouldBracket) {
 							collected += "(";
 						}
-						for (auto rule : rule->getChildren()) {
+						for (const auto& child : rule.getChildren()) {
 							if (first) {
 								first = false;
 							}
 							else {
 								collected += seperator;
 							}
-							collected += visitor->visit(rule, BracketHints(!aCollection, type));
+							collected += visitor->visit(child, BracketHints(!aCollection, type));
 						}
 
 						if (shouldBracket) {
@@ -344,6 +386,23 @@ namespace flock {
 					const string seperator;
 				};
 
+				/// <summary>
+				/// Operators = ? FLOCK operators A ; sum left 1 B ; power right 2 C ?
+				/// </summary>
+				class PrintOperators : public TypedRuleStrategy<Input, Output, OperatorsRule, PrintOperators> {
+				public:
+					PrintOperators() : TypedRuleStrategy<Input, Output, OperatorsRule, PrintOperators>() {}
+
+					Output acceptTyped(const _sp<PrintVisitor>& visitor, OperatorsRule& rule, const Input& bracketHints) {
+						string collected = colourize(Colour::DARK_CYAN, "? FLOCK operators ") + visitor->visit(rule.getOperand(), BracketHints(false, -1));
+						for (const OperatorsRule::Operator& op : rule.getOperators()) {
+							collected += colourize(Colour::DARK_CYAN, " ; " + op.name + (op.associativity == Associativity::Left ? " left " : " right ") + to_string(op.precedence) + " ");
+							collected += visitor->visit(op.rule, BracketHints(false, -1));
+						}
+						return collected + colourize(Colour::DARK_CYAN, " ?");
+					}
+				};
+
 				class PrintLibraryStrategy : public LibraryStrategy<Input, Output> {
 				public:
 					virtual Output accept(const _sp<RuleVisitor<Input, Output>> visitor, _sp<RuleLibrary> library, Input input) override {
@@ -370,6 +429,7 @@ namespace flock {
 					strategies->addStrategy(StringRules::EqualChar, make_shared<PrintEqualsChar>());
 					strategies->addStrategy(StringRules::EqualString, make_shared<PrintEqualsString>());
 					strategies->addStrategy(StringRules::CharRange, make_shared<PrintRange>());
+					strategies->addStrategy(StringRules::CharClass, make_shared<PrintCharClass>());
 					strategies->addStrategy(LogicRules::Not, make_shared<PrintNot>());
 					strategies->addStrategy(LogicRules::AnyBut, make_shared<PrintAnyBut>());
 					strategies->addStrategy(LogicRules::Repeat, make_shared<PrintRepeat>());
@@ -381,6 +441,7 @@ namespace flock {
 					strategies->addStrategy(LogicRules::Or, make_shared<PrintCollection>(" | "));
 					strategies->addStrategy(LogicRules::And, make_shared<PrintCollection>(" & "));
 					strategies->addStrategy(LogicRules::XOr, make_shared<PrintCollection>(" ^ "));
+					strategies->addStrategy(LogicRules::Operators, make_shared<PrintOperators>());
 					return strategies;
 				}
 			}
@@ -17,46 +17,74 @@
 #ifndef FLOCK_COMPILER_FILE_CHAR_SUPPLIER_H
 #define FLOCK_COMPILER_FILE_CHAR_SUPPLIER_H
 #include "Supplier.h"
-#include <fstream>
+#include "MappedSource.h"
+#include <cstdio>
+#include <algorithm>
+#include <memory>
 #include <string>
 namespace flock {
     namespace supplier {
+        /// <summary>
+        /// Supplies the characters of a file, straight out of its mapping.
+        /// Anything that can work on bytes directly should use getSource() instead, and skip the per character call.
+        /// </summary>
         class FileCharSupplier : public Supplier<int>
         {
         public:
+            FileCharSupplier(std::string fileName) : FileCharSupplier(std::make_shared<source::MappedSource>(fileName)) { }
+            FileCharSupplier(std::shared_ptr<source::MappedSource> source) : source(source) { }
+
             int supply() override {
-                if (myfile == nullptr) {
-                    myfile = &std::ifstream(fileName, std::ifstream::in);
+                if (!available()) {
+                    return EOF;
                 }
-                if ((*myfile).is_open()) {
-                    if ((*myfile).eof()) {
-                        (*myfile).close();
-                        return  EOF;
-                    }
-                    // We may want to buffer for effeciency
-                    int next = (*myfile).get();
-                    if (next == EOF) {
-                        (*myfile).close();
-                    }
-                    return next;
+                position++;
+                return static_cast<unsigned char>(*next++);
+            }
+
+            /// <summary>
+            /// Mapped bytes are never waited on, there is always another until the end of the file.
+            /// </summary>
+            bool isAvailable() override {
+                return available();
+            }
+
+            int supplyInto(int* into, const int amount) override {
+                if (!available()) {
+                    return 0;
+                }
+                const int count = static_cast<int>(std::min<size_t>(amount, last - next));
+                for (int i = 0; i < count; i++) {
+                    into[i] = static_cast<unsigned char>(next[i]);
                 }
-                return EOF;
+                next += count;
+                position += count;
+                return count;
+            }
+
+            std::shared_ptr<source::MappedSource> getSource() {
+                return source;
             }
-            FileCharSupplier(std::string fileName) : fileName (fileName){ }
         private:
-            /*
-            * Basic Safety, close in case we are not using it.
-            */
-            ~FileCharSupplier() {
-                if ((*myfile).is_open()) {
-                    (*myfile).close();
+            bool available() {
+                if (next == last) {
+                    // windowed files hand us the next window, everything else is one span.
+                    source::ByteSpan span = source->spanFrom(position);
+                    if (span.empty()) {
+                        return false;
+                    }
+                    next = span.begin();
+                    last = span.end();
                 }
-                delete myfile;
+                return true;
             }
-            std::string fileName;
-            std::ifstream *myfile = nullptr;
+
+            std::shared_ptr<source::MappedSource> source;
+            size_t position = 0;
+            const char* next = nullptr;
+            const char* last = nullptr;
         };
 
     }
 }
-#endif
\ No newline at end of file
+#endif
@@ -22,11 +22,18 @@
 #include "Rules.h"
 
 #include "ConsoleCharSupplier.h"
+#include "MappedSource.h"
 #include "LocationSupplier.h"
 #include "SourceEvaluation.h"
+#include "RuleMachine.h"
+#include "DeferredEvaluation.h"
+#include "RuleOptimiser.h"
 #include "EBNFPrinter.h"
 #include "FlockGrammar.h"
+#include "Benchmark.h"
 #include <iostream>
+#include <algorithm>
+#include <set>
 
 using namespace std;
 using namespace flock;
@@ -45,6 +52,19 @@ static string printRules(_sp<RuleLibrary> library) {
 
 
 
+/// <summary>
+/// The library as it was, how many rules each pass took it to, and the library it ended up as, in EBNF.
+/// </summary>
+static string printOptimiseReport(_sp<RuleLibrary> before, _sp<RuleLibrary> after, const vector<optimiser::PassReport>& report) {
+	string out = colourize(Colour::YELLOW, "\n(* === BEFORE, " + to_string(analysis::countRules(before)) + " RULES === *)") + printRules(before);
+	out += colourize(Colour::YELLOW, "\n(* === PASSES === *)\n");
+	for (const optimiser::PassReport& pass : report) {
+		out += "(* " + pass.name + ": " + to_string(pass.rulesBefore) + " -> " + to_string(pass.rulesAfter) + " rules *)\n";
+	}
+	out += colourize(Colour::YELLOW, "\n(* === AFTER, " + to_string(analysis::countRules(after)) + " RULES === *)") + printRules(after);
+	return out;
+}
+
 static void MainLoop(_sp<RuleLibrary> library) {
 	_sp<ConsoleCharSupplier> consoleSupplier = make_shared<ConsoleCharSupplier>();
 	_sp<LocationSupplier> locationSupplier = make_shared<LocationSupplier>(consoleSupplier);
@@ -66,7 +86,7 @@ static void MainLoop(_sp<RuleLibrary> library) {
 			std::cout << colourize(Colour::DARK_CYAN, "\nready> ");
 		}
 		else {
-			std::cout << colourize(Colour::DARK_GREEN, "\nFOUND: " + to_string(output.idx) + " characters\n") << *output.syntaxNodes[0];
+			std::cout << colourize(Colour::DARK_GREEN, "\nFOUND: " + to_string(output.idx - input.idx) + " characters\n") << *output.getNodes()[0];
 		}
 		/*std::pair<string, _sp<types::SyntaxNode>> ret = types::evaluateAgainstAllRules(locationSupplier, library);
 
@@ -87,10 +107,326 @@ static void MainLoop(_sp<RuleLibrary> library) {
 	}
 }
 
-int main()
+/// <summary>
+/// How to parse, as set on the command line.
+/// </summary>
+struct ParseOptions {
+	// how much unconsumed input we will hold on to, 0 for no bound.
+	size_t maxWindow = SlidingWindow<char>::UNBOUNDED;
+	// compile the library for the machine, rather than walk the rules.
+	bool useMachine = false;
+	// only make syntax nodes for the symbols that win, rebuilding them from where each rule matched.
+	bool deferNodes = false;
+	// print each symbol as events once it is matched, rather than as a tree.
+	bool events = false;
+	// only check that each file parses, and where it first fails, without making any syntax nodes.
+	bool validate = false;
+	// which rules the rule walker remembers.
+	_sp<history::MemoPolicy> memo = history::memoiseProductions();
+	// let the rule walker stop remembering rules that don't pay for it.
+	bool adaptive = false;
+	// report what the memo table did.
+	bool profile = false;
+	// rewrite the library into one that is quicker to walk first.
+	bool optimise = true;
+	// print the library before and after it is optimised, and how many rules each pass left.
+	bool optimiseReport = false;
+};
+
+/// <summary>
+/// all, productions or symbols, anything else is a comma separated list of the symbols and parts to remember.
+/// </summary>
+static _sp<history::MemoPolicy> memoPolicyFor(const string option) {
+	if (option == "all") {
+		return history::memoiseAll();
+	}
+	if (option == "productions") {
+		return history::memoiseProductions();
+	}
+	if (option == "symbols") {
+		return history::memoiseSymbols();
+	}
+	std::set<string> names;
+	size_t start = 0;
+	while (start <= option.size()) {
+		const size_t comma = std::min(option.find(',', start), option.size());
+		if (comma > start) {
+			names.insert(option.substr(start, comma - start));
+		}
+		start = comma + 1;
+	}
+	return history::memoiseSelected({}, names);
+}
+
+static void PrintMemoStats(_sp<Strategies<evaluator::Input, evaluator::Output>> strategies) {
+	const auto caching = visitor::findStrategies<history::CachingStrategies<evaluator::Input, evaluator::Output, evaluator::Key>>(strategies);
+	if (!caching) {
+		return;
+	}
+	const history::MemoStats& stats = caching->getMemo()->getStats();
+	std::cout << colourize(Colour::DARK_CYAN, "Memo " + history::MemoPolicy::modeName(caching->getPolicy()->getMode())
+		+ ": " + to_string(stats.visits) + " visits, " + to_string(stats.transient) + " transient, " + to_string(stats.guarded) + " guarded, "
+		+ to_string(stats.hits) + " hits (" + to_string(static_cast<int>(stats.hitRate() * 100)) + "%), " + to_string(stats.stored) + " stored, "
+		+ "peaked at " + to_string(stats.peakEntries) + " entries, " + to_string(stats.peakBytes) + " bytes\n");
+	if (caching->getPolicy()->isAdaptive()) {
+		const history::AdaptationStats& adapted = caching->getPolicy()->getAdaptationStats();
+		string off;
+		for (const string& name : caching->getPolicy()->getSwitchedOff()) {
+			off += " " + name;
+		}
+		std::cout << colourize(Colour::DARK_CYAN, "Adaptive: switched off " + to_string(adapted.switchedOff) + " times, back on " + to_string(adapted.switchedOn)
+			+ ", " + to_string(adapted.offVisits) + " visits while off, off at the end:" + (off.empty() ? " none" : off) + "\n");
+	}
+}
+
+/// <summary>
+/// How many symbol trials and alternatives the first sets skipped, in all and for each symbol or part that skipped any.
+/// </summary>
+static void PrintPruneStats(_sp<Strategies<evaluator::Input, evaluator::Output>> strategies) {
+	const auto pruned = visitor::findStrategies<evaluator::FirstSetStrategies>(strategies);
+	if (!pruned) {
+		return;
+	}
+	vector<evaluator::ProductionPruning> productions = pruned->getPruning()->byProduction();
+	evaluator::PruneStats trials;
+	evaluator::PruneStats alternatives;
+	for (const evaluator::ProductionPruning& production : productions) {
+		trials.checked += production.trials.checked;
+		trials.skipped += production.trials.skipped;
+		alternatives.checked += production.alternatives.checked;
+		alternatives.skipped += production.alternatives.skipped;
+	}
+	std::cout << colourize(Colour::DARK_CYAN, "First sets: skipped " + to_string(trials.skipped) + " of " + to_string(trials.checked) + " symbol trials, "
+		+ to_string(alternatives.skipped) + " of " + to_string(alternatives.checked) + " alternatives\n");
+	std::stable_sort(productions.begin(), productions.end(), [](const evaluator::ProductionPruning& a, const evaluator::ProductionPruning& b) {
+		return a.trials.skipped + a.alternatives.skipped > b.trials.skipped + b.alternatives.skipped;
+	});
+	for (const evaluator::ProductionPruning& production : productions) {
+		if (production.trials.skipped + production.alternatives.skipped == 0) {
+			break;
+		}
+		std::cout << colourize(Colour::DARK_CYAN, "  " + production.name + ": " + to_string(production.trials.skipped) + "/" + to_string(production.trials.checked) + " trials, "
+			+ to_string(production.alternatives.skipped) + "/" + to_string(production.alternatives.checked) + " alternatives\n");
+	}
+}
+
+static void Parse(_sp<RuleLibrary> library, _sp<Strategies<evaluator::Input, evaluator::Output>> strategies, _sp<LocationSupplier> locationSupplier, const string name, const bool profile) {
+	_sp<evaluator::EvaluationVisitor>  visitor = make_shared<evaluator::EvaluationVisitor>(library, strategies);
+
+	while (true) {
+		visitor->clear();
+		strategies->clear();
+		evaluator::Input input = evaluator::Input(locationSupplier);
+		evaluator::Output output = visitor->begin(input);
+		// an empty match would never move us forward.
+		if (output.isFailure() || output.idx == input.idx) {
+			break;
+		}
+		std::cout << colourize(Colour::DARK_GREEN, "\nFOUND: " + to_string(output.idx - input.idx) + " characters\n");
+		if (output.hasNodes()) {
+			std::cout << *output.getNodes()[0];
+		}
+	}
+	if (locationSupplier->isEnd(locationSupplier->getStart())) {
+		std::cout << colourize(Colour::DARK_GREEN, "\nDONE\n");
+	}
+	else {
+		std::cout << colourize(Colour::RED, "\nUNABLE TO PARSE THE REST OF " + name + "\n");
+	}
+	WindowStats stats = locationSupplier->getWindowStats();
+	if (stats.peak > 0) {
+		std::cout << colourize(Colour::DARK_CYAN, "Window peaked at " + to_string(stats.peak) + " characters, " + to_string(stats.released) + " released\n");
+	}
+	if (profile) {
+		PrintMemoStats(strategies);
+		PrintPruneStats(strategies);
+	}
+}
+
+/// <summary>
+/// Prints the events, indented by how deep they are, with the text of each token.
+/// </summary>
+class PrintingConsumer : public syntax::SyntaxConsumer {
+public:
+	void setSource(_sp<LocationSupplier> source) {
+		locationSupplier = source;
+	}
+	virtual void enter(const string& symbol, const int start) override {
+		std::cout << string(depth * 2, ' ') << colourize(Colour::YELLOW, symbol) << " " << start << "\n";
+		depth++;
+	}
+	virtual void exit(const string& symbol, const int end) override {
+		depth--;
+		std::cout << string(depth * 2, ' ') << "/" << colourize(Colour::YELLOW, symbol) << " " << end << "\n";
+	}
+	virtual void token(const string& symbol, const int start, const int end) override {
+		std::cout << string(depth * 2, ' ') << colourize(Colour::YELLOW, symbol) << " " << start << "-" << end
+			<< ": \"" << colourize(Colour::GREEN, string(locationSupplier->view(start, end))) << "\"\n";
+	}
+protected:
+	_sp<LocationSupplier> locationSupplier;
+	int depth = 0;
+};
+
+/// <summary>
+/// "-" parses standard input, anything else is a file.
+/// </summary>
+static void ParseFile(_sp<RuleLibrary> library, const string fileName, const ParseOptions& options) {
+	const auto consumer = make_shared<PrintingConsumer>();
+	_sp<Strategies<evaluator::Input, evaluator::Output>> strategies = options.useMachine ? machine::machineStrategies(library)
+		: options.events ? deferred::streamingStrategies(consumer, options.memo)
+		: options.deferNodes ? deferred::deferredStrategies(options.memo) : evaluator::evaluationStrategies(options.memo);
+	_sp<LocationSupplier> locationSupplier = fileName == "-" ? make_shared<LocationSupplier>(make_shared<StreamCharSupplier>(std::cin), options.maxWindow)
+		: make_shared<LocationSupplier>(make_shared<MappedSource>(fileName), options.maxWindow);
+	consumer->setSource(locationSupplier);
+	Parse(library, strategies, locationSupplier, fileName == "-" ? "standard input" : fileName, options.profile);
+}
+
+static string LineAndColumn(_sp<LocationSupplier> locationSupplier, const int position) {
+	const Location location = locationSupplier->locate(position);
+	return to_string(location.line) + ":" + to_string(location.column);
+}
+
+/// <summary>
+/// Whether the file parses, and if not, how far it got, and where the farthest failure was.
+/// </summary>
+static bool ValidateFile(_sp<RuleLibrary> library, const string fileName, const ParseOptions& options) {
+	_sp<LocationSupplier> locationSupplier = fileName == "-" ? make_shared<LocationSupplier>(make_shared<StreamCharSupplier>(std::cin), options.maxWindow)
+		: make_shared<LocationSupplier>(make_shared<MappedSource>(fileName), options.maxWindow);
+	const evaluator::Validation validation = evaluator::validate(library, locationSupplier, options.memo);
+	if (validation.passed) {
+		std::cout << colourize(Colour::DARK_GREEN, "PASS " + fileName + "\n");
+	}
+	else {
+		std::cout << colourize(Colour::RED, "FAIL " + fileName + ": parsed up to " + LineAndColumn(locationSupplier, validation.end)
+			+ ", farthest failure at " + LineAndColumn(locationSupplier, validation.farthest) + "\n");
+	}
+	return validation.passed;
+}
+
+int main(int argc, char* argv[])
 {
 	std::cout << colourize(Colour::YELLOW, "==== Hello Flock ====\n\n");
-	_sp<RuleLibrary> library = flock::grammar::createFlockLibrary();
+	_sp<RuleLibrary> library;
+	try {
+		library = flock::grammar::createFlockLibrary();
+	}
+	catch (string exc) {
+		std::cout << colourize(Colour::RED, "\n" + exc + "\n");
+		return 1;
+	}
+	if (argc > 2 && string(argv[1]) == "--check") {
+		try {
+			const bool optimised = flock::benchmark::runOptimiserChecks(library, argv[2], std::cout);
+			const bool adaptive = flock::benchmark::runAdaptiveChecks(library, argv[2], std::cout);
+			return optimised && adaptive ? 0 : 1;
+		}
+		catch (string exc) {
+			std::cout << colourize(Colour::RED, "\n" + exc + "\n");
+			return 1;
+		}
+	}
+	if (argc > 2 && string(argv[1]) == "--bench") {
+		try {
+			flock::benchmark::runSupplierBenchmarks(argv[2], std::cout);
+			flock::benchmark::runParseBenchmarks(library, argv[2], std::cout);
+			flock::benchmark::runMemoBenchmarks(library, argv[2], std::cout);
+			flock::benchmark::runFactoringBenchmarks(library, argv[2], std::cout);
+			flock::benchmark::runRepeatBenchmarks(std::cout);
+			flock::benchmark::runSpanBenchmarks(std::cout);
+			flock::benchmark::runKeywordBenchmarks(std::cout);
+			flock::benchmark::runBacktrackBenchmarks(std::cout);
+			flock::benchmark::runOperatorBenchmarks(std::cout);
+			flock::benchmark::runTreeBenchmarks(library, argv[2], std::cout);
+		}
+		catch (string exc) {
+			std::cout << colourize(Colour::RED, "\n" + exc + "\n");
+			return 1;
+		}
+		return 0;
+	}
+	ParseOptions options;
+	int arg = 1;
+	while (arg < argc && string(argv[arg]).rfind("--", 0) == 0) {
+		const string option = argv[arg++];
+		if (option == "--vm") {
+			options.useMachine = true;
+		}
+		else if (option == "--max-window" && arg < argc) {
+			options.maxWindow = std::stoul(argv[arg++]);
+		}
+		else if (option == "--memo" && arg < argc) {
+			options.memo = memoPolicyFor(argv[arg++]);
+		}
+		else if (option == "--events") {
+			options.events = true;
+		}
+		else if (option == "--validate") {
+			options.validate = true;
+		}
+		else if (option == "--deferred") {
+			options.deferNodes = true;
+		}
+		else if (option == "--adaptive") {
+			options.adaptive = true;
+		}
+		else if (option == "--profile") {
+			options.profile = true;
+		}
+		else if (option == "--no-optimise") {
+			options.optimise = false;
+		}
+		else if (option == "--optimise-report") {
+			options.optimiseReport = true;
+		}
+		else {
+			std::cout << colourize(Colour::RED, "Unknown option " + option + "\n");
+			return 1;
+		}
+	}
+	if (options.adaptive) {
+		options.memo->adapt();
+	}
+	if (options.optimise) {
+		try {
+			vector<optimiser::PassReport> report;
+			const _sp<RuleLibrary> optimised = optimiser::optimise(library, optimiser::passesFor(options.memo->getMode()), options.optimiseReport ? &report : nullptr);
+			if (options.optimiseReport) {
+				std::cout << printOptimiseReport(library, optimised, report);
+				if (arg == argc) {
+					return 0;
+				}
+			}
+			library = optimised;
+		}
+		catch (string exc) {
+			std::cout << colourize(Colour::RED, "\n" + exc + "\n");
+			return 1;
+		}
+	}
+	if (options.validate && arg < argc) {
+		bool passed = true;
+		for (; arg < argc; arg++) {
+			try {
+				passed = ValidateFile(library, argv[arg], options) && passed;
+			}
+			catch (string exc) {
+				std::cout << colourize(Colour::RED, "FAIL " + string(argv[arg]) + ": " + exc + "\n");
+				passed = false;
+			}
+		}
+		return passed ? 0 : 1;
+	}
+	if (arg < argc) {
+		try {
+			ParseFile(library, argv[arg], options);
+		}
+		catch (string exc) {
+			std::cout << colourize(Colour::RED, "\n" + exc + "\n");
+			return 1;
+		}
+		return 0;
+	}
 	std::cout << printRules(library);
 	MainLoop(library);
 	return 0;
@@ -75,6 +75,7 @@ namespace flock {
 			library->addPart("aliasOrIdentifier", rule::OR({ rule::RULE("alias"),rule::RULE("_identifier") }));
 			library->addPart("aliasListOrIdentifier", rule::OR({ rule::RULE("aliasOrIdentifier"),rule::RULE("_aliasList") }));
 			library->addSymbol("use", rule::SEQ({ rule::EQ("use") , rule::RULE("wsp*") , rule::OPT(rule::RULE("aliasListOrIdentifier")), rule::RULE("lineEnd+") }));
+			library->freeze();
 			return library;
 		};
 
@@ -19,48 +19,255 @@
  // your declarations (and certain types of definitions) here
 
 #include "Source.h"
-#include "CachedSupplier.h"
+#include "Supplier.h"
+#include "MappedSource.h"
+#include "FileCharSupplier.h"
+#include "SlidingWindow.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace flock {
 	using namespace source;
 	namespace supplier {
-		class LocationSupplier : public CachedSupplier <Location, _sp<Range>> {
+		/// <summary>
+		/// Holds the characters the evaluator can still backtrack over, addressed by their position in the source.
+		///
+		/// Positions are all we hand out, a Location is only worked out when locate is called, or a Range is printed.
+		/// Whole file mappings are used in place, anything else is copied into a sliding window a character at a time as it is polled,
+		/// and let go of once it has been popped, so streamed input of any length is parsed in the memory its longest construct needs.
+		/// </summary>
+		class LocationSupplier : public SourceText, public std::enable_shared_from_this<LocationSupplier> {
 		public:
-			LocationSupplier(_sp<Supplier<int>> charSupplier) : charSupplier(charSupplier) {}
+			/// <summary>
+			/// Positions are ints, so sources longer than this are refused rather than read with positions that wrap.
+			/// </summary>
+			static constexpr int MAX_POSITION = std::numeric_limits<int>::max();
 
-			virtual _sp<Range> pollRangeBetween(const int startIdx = 0, const int endIdx = 1) override {
-				auto option = poll(startIdx);
-				if (!option) {
+			LocationSupplier(_sp<Supplier<int>> charSupplier, const size_t maxWindow = SlidingWindow<char>::UNBOUNDED) : charSupplier(charSupplier), window(maxWindow) {}
+			LocationSupplier(_sp<MappedSource> source, const size_t maxWindow = SlidingWindow<char>::UNBOUNDED) : mapped(source), window(maxWindow) {
+				if (source->size() > static_cast<size_t>(MAX_POSITION)) {
+					throw string("Unable to read " + source->getFileName() + ", it is " + std::to_string(source->size()) + " bytes and positions only go up to " + std::to_string(MAX_POSITION));
+				}
+				if (source->isWindowed()) {
+					charSupplier = make_shared<FileCharSupplier>(source);
+				}
+				else {
+					data = source->span().data;
+					end = static_cast<int>(source->span().size);
+					ended = true;
+				}
+			}
+
+			/// <summary>
+			/// The character at position, or EOF if there isn't one.
+			/// </summary>
+			int poll(const int position) {
+				if (position < base || (position >= end && !load(position))) {
+					return EOF;
+				}
+				return static_cast<unsigned char>(data[position - base]);
+			}
+
+			bool isEnd(const int position) {
+				return poll(position) == EOF;
+			}
+
+			_sp<Range> pollRange(const int amount = 1, const int startIdx = 0) {
+				return pollRangeBetween(startIdx, startIdx + amount);
+			}
+
+			/// <summary>
+			///
+			/// </summary>
+			/// <param name="startIdx">Start Inclusive</param>
+			/// <param name="endIdx"> End Exclusive</param>
+			/// <returns>the range, cut short at the end of the source, or nullptr if there is nothing at startIdx</returns>
+			_sp<Range> pollRangeBetween(const int startIdx = 0, const int endIdx = 1) {
+				if (isEnd(startIdx)) {
 					return nullptr;
 				}
-				Range* range = new Range(option);
-				for (int nextId = startIdx + 1; nextId < endIdx; nextId++) {
-					auto option = poll(nextId);
+				if (endIdx > end) {
+					load(endIdx - 1);
+				}
+				return make_shared<Range>(shared_from_this(), startIdx, std::max(startIdx, std::min(endIdx, end)));
+			}
+
+			/// <summary>
+			/// Whether the source at position starts with value, compared in place.
+			/// </summary>
+			bool startsWith(const int position, const string& value) {
+				const int length = static_cast<int>(value.size());
+				if (position < base || (length > 0 && !load(position + length - 1))) {
+					return false;
+				}
+				return memcmp(data + (position - base), value.data(), length) == 0;
+			}
 
-					if (!option) {
-						return std::make_shared<Range>(*range);
+			/// <summary>
+			/// How many characters, from position on, are in the set, scanned in place a block at a time, loading more as each runs out.
+			/// </summary>
+			int spanOf(const int position, const simd::ByteSet& set) {
+				if (position < base) {
+					return 0;
+				}
+				int scanned = position;
+				while (scanned < end || load(scanned)) {
+					scanned += static_cast<int>(simd::spanOf(set, data + (scanned - base), end - scanned));
+					if (scanned < end) {
+						break;
 					}
-					range = new Range(*range, option);
 				}
-				return std::make_shared<Range>(*range);
-			};
+				return scanned - position;
+			}
+
+			/// <summary>
+			/// How many characters, from position on, come before the first of the literals, or the end.
+			/// Candidates are found in place, as spanOf does, and each is checked with startsWith, which loads what a literal runs on into.
+			/// </summary>
+			int spanUntil(const int position, const simd::LiteralSet& literals) {
+				if (position < base || literals.hasEmpty()) {
+					return 0;
+				}
+				int scanned = position;
+				while (scanned < end || load(scanned)) {
+					scanned += static_cast<int>(literals.findCandidate(data + (scanned - base), end - scanned));
+					if (scanned >= end) {
+						continue;
+					}
+					for (const string& literal : literals.getLiterals()) {
+						if (startsWith(scanned, literal)) {
+							return scanned - position;
+						}
+					}
+					scanned++;
+				}
+				return scanned - position;
+			}
+
+			/// <summary>
+			/// Everything before the current start plus amount has been consumed, and will not be polled again.
+			/// It is let go of the next time characters are loaded.
+			/// </summary>
+			void popRange(const int amount = 1) {
+				start = std::min(start + amount, std::max(end, start));
+				window.commit(start);
+			}
+
+			/// <summary>
+			/// The first position that has not been consumed.
+			/// </summary>
+			int getStart() {
+				return start;
+			}
 
-			_sp<Location> supply() override
-			{
-				int next = charSupplier->supply();
-				if (next == EOF) {
-					return previous = nullptr;
+			virtual Location locate(const int position) override {
+				scanLines(std::min(position + 1, end));
+				return lines.locate(position, poll(position));
+			}
+
+			/// <summary>
+			/// Consumed text stays put until the next characters are loaded, so a range can still be printed once it has been popped.
+			/// Text that has been released comes back empty.
+			/// </summary>
+			virtual std::string_view view(const int startIdx, const int endIdx) override {
+				if (endIdx <= startIdx || !holds(startIdx, endIdx)) {
+					return std::string_view();
 				}
-				return previous = Location::next(previous, next);
+				return std::string_view(data + (startIdx - base), endIdx - startIdx);
+			}
+
+			virtual bool holds(const int startIdx, const int endIdx) override {
+				return endIdx <= startIdx || (startIdx >= base && endIdx <= end);
 			}
+
+			/// <summary>
+			/// How much of the source is being held on to, nothing is held for a whole file mapping.
+			/// </summary>
+			WindowStats getWindowStats() const {
+				return window.getStats();
+			}
+
 			void clear() {
-				store.clear();
-				previous = nullptr;
+				start = 0;
+				lines.clear();
+				if (charSupplier) {
+					window.clear();
+					data = window.data();
+					base = 0;
+					end = 0;
+					ended = false;
+				}
 			}
 
 		protected:
-			_sp<Location> previous = nullptr;
+			bool load(const int position) {
+				if (ended) {
+					return end > position;
+				}
+				release();
+				while (end <= position && !ended) {
+					// read ahead by a block, as far as the window will let us, but always as far as we were asked.
+					const int needed = position - end + 1;
+					const int wanted = std::max(needed, static_cast<int>(std::min<size_t>(BLOCK_SIZE, window.room())));
+					if (static_cast<int>(block.size()) < wanted) {
+						block.resize(wanted);
+					}
+					const int count = charSupplier->supplyInto(block.data(), wanted);
+					if (count == 0) {
+						ended = true;
+					}
+					else if (count > MAX_POSITION - end) {
+						throw string("Unable to read past position " + std::to_string(MAX_POSITION) + ", the source is too long for positions to address");
+					}
+					else {
+						window.append(block.data(), count);
+						end += count;
+					}
+				}
+				data = window.data();
+				return end > position;
+			}
+
+			void scanLines(const int position) {
+				const int scanned = lines.getScanned();
+				if (position > scanned) {
+					lines.scan(data + (scanned - base), position - scanned);
+				}
+			}
+
+			/// <summary>
+			/// Drops the consumed characters, once there are enough of them to be worth moving the rest down.
+			/// </summary>
+			void release() {
+				if (!window.worthReleasing()) {
+					return;
+				}
+				// once they are gone we can't find the line breaks in them.
+				scanLines(start);
+				window.release();
+				data = window.data();
+				base = window.getBase();
+			}
+
+			static const int BLOCK_SIZE = 4096;
+
 			_sp<Supplier<int>> charSupplier;
+			_sp<MappedSource> mapped;
+			SlidingWindow<char> window;
+			// what the char supplier fills, before it goes into the window.
+			std::vector<int> block;
+			const char* data = nullptr;
+			// position of data[0]
+			int base = 0;
+			// one past the last position loaded
+			int end = 0;
+			int start = 0;
+			bool ended = false;
+			LineIndex lines;
 		};
 
 	}
@@ -20,6 +20,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <set>
 
  ///
  /// Basic Grammar, that allows to employ basic BNF style grammars in language detection.
@@ -43,7 +44,9 @@ namespace flock {
 			Sequence = -8,
 			Or = -9,
 			And = -10,
-			XOr = -11
+			XOr = -11,
+			// Specialist Collections
+			Operators = -12
 		};
 
 		/// <summary>
@@ -70,28 +73,208 @@ namespace flock {
 
 		/// <summary>
 		/// Provides a way of aliasing rules from the rules library.
+		/// Once the library is frozen the alias is bound to the rule it names, see RuleLibrary::freeze.
 		/// </summary>
 		class AliasRule : public TerminalRule {
 		public:
 			AliasRule(const string alias) : TerminalRule(LogicRules::Alias), alias(alias) {}
 
-			string getAlias() {
+			const string& getAlias() {
 				return alias;
 			}
+
+			bool isBound() {
+				return target != nullptr;
+			}
+			/// <summary>
+			/// The rule named, only when bound.
+			/// </summary>
+			const _sp<Rule>& getTarget() {
+				return *target;
+			}
+			/// <summary>
+			/// Whether the rule named is a symbol rather than a part, only when bound.
+			/// </summary>
+			bool isSymbol() {
+				return symbol;
+			}
+
+			void bind(const _sp<Rule>* toBind, const bool isSymbol) {
+				target = toBind;
+				symbol = isSymbol;
+			}
+			void unbind() {
+				target = nullptr;
+				symbol = false;
+			}
 		protected:
 			const string alias;
+			// held by the library, which does not hold us back, so the rules of a recursive grammar don't keep each other alive.
+			const _sp<Rule>* target = nullptr;
+			bool symbol = false;
+		};
+
+		enum class Associativity {
+			Left,
+			Right
 		};
 
+		/// <summary>
+		/// An operand, then any number of operators each followed by another, nested by the precedence and associativity of the operators, the way a tiered grammar of them would be, in a single pass.
+		/// Its children are the operand and then the rules of the operators, in the order they are tried, the first that matches is taken, so order them as you would an or.
+		/// </summary>
+		class OperatorsRule : public CollectionRule {
+		public:
+			/// <summary>
+			/// Each one the operator joins is a node of its name, higher precedences binding tighter.
+			/// </summary>
+			struct Operator {
+				string name;
+				int precedence;
+				Associativity associativity;
+				_sp<Rule> rule;
+			};
+
+			/// <summary>
+			/// Operands first to last, joined around the operator at op, which is between operand op and op + 1.
+			/// </summary>
+			struct Fold {
+				int op;
+				int first;
+				int last;
+			};
+
+			OperatorsRule(_sp<Rule> operand, vector<Operator> operators) : CollectionRule(LogicRules::Operators, childrenOf(operand, operators)), operators(operators) {}
+
+			const _sp<Rule>& getOperand() {
+				return children.front();
+			}
+			const vector<Operator>& getOperators() {
+				return operators;
+			}
+
+			/// <summary>
+			/// How a chain nests, given which operator was matched between each operand and the next, by where it is in the table.
+			/// Tightest first, so everything either side of a fold has been folded before it is.
+			/// </summary>
+			vector<Fold> fold(const vector<int>& matched) const {
+				vector<Fold> folds;
+				folds.reserve(matched.size());
+				// the operators still waiting for the end of their right hand side, and the first operand of each side.
+				vector<int> waiting;
+				vector<int> firsts = { 0 };
+				const auto reduce = [&](const int last) {
+					const int op = waiting.back();
+					waiting.pop_back();
+					firsts.pop_back();
+					folds.push_back(Fold{ op, firsts.back(), last });
+				};
+				for (int op = 0; op < static_cast<int>(matched.size()); op++) {
+					const Operator& next = operators[matched[op]];
+					while (!waiting.empty()) {
+						const int precedence = operators[matched[waiting.back()]].precedence;
+						if (precedence < next.precedence || (precedence == next.precedence && next.associativity == Associativity::Right)) {
+							break;
+						}
+						reduce(op);
+					}
+					waiting.push_back(op);
+					firsts.push_back(op + 1);
+				}
+				while (!waiting.empty()) {
+					reduce(static_cast<int>(matched.size()));
+				}
+				return folds;
+			}
+
+		protected:
+			static _sp_vec<Rule> childrenOf(const _sp<Rule>& operand, const vector<Operator>& operators) {
+				_sp_vec<Rule> children = { operand };
+				for (const Operator& op : operators) {
+					children.push_back(op.rule);
+				}
+				return children;
+			}
+
+			const vector<Operator> operators;
+		};
+
+		inline void types::RuleLibrary::freeze() {
+			if (frozen) {
+				return;
+			}
+			vector<Rule*> pending;
+			for (const string& name : getSymbolNames()) {
+				pending.push_back(getNode(name).get());
+			}
+			for (const string& name : getPartNames()) {
+				pending.push_back(parts->getNode(name).get());
+			}
+			// rules can be shared between expressions, so each is only looked at once.
+			std::set<Rule*> seen;
+			vector<string> missing;
+			while (!pending.empty()) {
+				Rule* rule = pending.back();
+				pending.pop_back();
+				if (!seen.insert(rule).second) {
+					continue;
+				}
+				if (AliasRule* alias = dynamic_cast<AliasRule*>(rule)) {
+					if (alias->isBound()) {
+						missing.push_back(alias->getAlias() + " (bound by another library)");
+						continue;
+					}
+					const _sp<Rule>* symbol = findNode(alias->getAlias());
+					const _sp<Rule>* target = symbol ? symbol : parts->findNode(alias->getAlias());
+					if (!target) {
+						missing.push_back(alias->getAlias());
+						continue;
+					}
+					alias->bind(target, symbol != nullptr);
+					bound.push_back(alias);
+				}
+				else if (UnaryRule* unary = dynamic_cast<UnaryRule*>(rule)) {
+					pending.push_back(unary->getChild().get());
+				}
+				else if (CollectionRule* collection = dynamic_cast<CollectionRule*>(rule)) {
+					for (const auto& child : collection->getChildren()) {
+						pending.push_back(child.get());
+					}
+				}
+			}
+			if (!missing.empty()) {
+				unfreeze();
+				string names;
+				for (const string& name : missing) {
+					names += (names.empty() ? "" : ", ") + name;
+				}
+				throw string("Unable to freeze the library, these rules do not exist: " + names);
+			}
+			frozen = true;
+		}
+
+		inline void types::RuleLibrary::unfreeze() {
+			for (Rule* rule : bound) {
+				static_cast<AliasRule*>(rule)->unbind();
+			}
+			bound.clear();
+			frozen = false;
+		}
+
 		/// <summary>
 		/// Helper class to save on the typing.
 		/// </summary>
 		/// <typeparam name="IN"></typeparam>
 		/// <typeparam name="OUT"></typeparam>
 		template<typename IN, typename OUT>
-		class LogicMixinsCombined : public BaseMixinsCombined<IN, OUT> {
+		class LogicMixinsCombined : public virtual BaseMixinsCombined<IN, OUT> {
 		public:
-			virtual IN nextInFromPrevious(IN previousInput, OUT previousOutput) = 0;
-			virtual OUT joinOutputs(OUT currentOut, OUT nextOut) {
+			virtual IN nextInFromPrevious(const IN& previousInput, const OUT& previousOutput) = 0;
+			/// <summary>
+			/// Whether to is further on than from, so a loop can tell that going round again would get nowhere.
+			/// </summary>
+			virtual bool hasMoved(const IN& from, const IN& to) = 0;
+			virtual OUT joinOutputs(const OUT&, const OUT& nextOut) {
 				return nextOut;
 			}
 		};
@@ -102,6 +285,12 @@ namespace flock {
 			LogicRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : MixinsRuleStrategy<IN, OUT, LogicMixinsCombined<IN, OUT>>(mixins) {}
 		};
 
+		template<typename IN, typename OUT, typename TYPED, typename DERIVED>
+		class TypedLogicRuleStrategy : public TypedMixinsRuleStrategy<IN, OUT, TYPED, DERIVED, LogicMixinsCombined<IN, OUT>> {
+		public:
+			TypedLogicRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedMixinsRuleStrategy<IN, OUT, TYPED, DERIVED, LogicMixinsCombined<IN, OUT>>(mixins) {}
+		};
+
 
 		/// <summary>
 		/// Asks the visitor too locate the alias rule, and then visit that.
@@ -110,14 +299,19 @@ namespace flock {
 		/// <typeparam name="IN"></typeparam>
 		/// <typeparam name="OUT"></typeparam>
 		template<typename IN, typename OUT>
-		class AliasRuleStrategy : public LogicRuleStrategy <IN, OUT> {
+		class AliasRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, AliasRule, AliasRuleStrategy<IN, OUT>> {
 		public:
-			AliasRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto aliasRule = std::dynamic_pointer_cast<AliasRule>(baseRule);
-
+			AliasRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, AliasRule, AliasRuleStrategy<IN, OUT>>(mixins) {}
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, AliasRule& rule, const IN& input) {
+				if (rule.isBound()) {
+					// checked when the library was frozen, so there is nothing to catch.
+					if (rule.isSymbol()) {
+						return visitor->visitSymbol(rule.getAlias(), rule.getTarget(), input);
+					}
+					return visitor->visitPart(rule.getAlias(), rule.getTarget(), input);
+				}
 				try {
-					return visitor->visitByName(aliasRule->getAlias(), input);
+					return visitor->visitByName(rule.getAlias(), input);
 				}
 				catch (string exc) {
 					cout << "\nexception was thrown: " << exc << "\n";
@@ -127,13 +321,12 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class AndRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class AndRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, CollectionRule, AndRuleStrategy<IN, OUT>> {
 		public:
-			AndRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			AndRuleStrategy(const _sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, CollectionRule, AndRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<CollectionRule>(baseRule);
-				const auto children = rule->getChildren();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, CollectionRule& rule, const IN& input) {
+				const auto& children = rule.getChildren();
 
 				const OUT firstOut = visitor->visit(children.at(0), input);
 				if (this->mixins->isFailure(firstOut)) {
@@ -150,13 +343,12 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class OrRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class OrRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, CollectionRule, OrRuleStrategy<IN, OUT>> {
 		public:
-			OrRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			OrRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, CollectionRule, OrRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<CollectionRule>(baseRule);
-				const auto children = rule->getChildren();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, CollectionRule& rule, const IN& input) {
+				const auto& children = rule.getChildren();
 
 				const OUT firstOut = visitor->visit(children.at(0), input);
 				if (!this->mixins->isFailure(firstOut)) {
@@ -173,13 +365,12 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class XOrRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class XOrRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, CollectionRule, XOrRuleStrategy<IN, OUT>> {
 		public:
-			XOrRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			XOrRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, CollectionRule, XOrRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<CollectionRule>(baseRule);
-				const auto children = rule->getChildren();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, CollectionRule& rule, const IN& input) {
+				const auto& children = rule.getChildren();
 
 				OUT successOut = visitor->visit(children.at(0), input);
 
@@ -203,13 +394,12 @@ namespace flock {
 
 
 		template<typename IN, typename OUT>
-		class SeqRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class SeqRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, CollectionRule, SeqRuleStrategy<IN, OUT>> {
 		public:
-			SeqRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			SeqRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, CollectionRule, SeqRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<CollectionRule>(baseRule);
-				const auto children = rule->getChildren();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, CollectionRule& rule, const IN& input) {
+				const auto& children = rule.getChildren();
 
 				IN currentInput = input;
 				OUT currentOut = visitor->visit(children.at(0), currentInput);
@@ -229,13 +419,12 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class OptionalRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class OptionalRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, UnaryRule, OptionalRuleStrategy<IN, OUT>> {
 		public:
-			OptionalRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			OptionalRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, UnaryRule, OptionalRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-				const auto child = rule->getChild();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, UnaryRule& rule, const IN& input) {
+				const auto& child = rule.getChild();
 
 				const OUT currentOut = visitor->visit(child, input);
 				if (this->mixins->isFailure(currentOut)) {
@@ -247,13 +436,12 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class NotRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class NotRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, UnaryRule, NotRuleStrategy<IN, OUT>> {
 		public:
-			NotRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			NotRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, UnaryRule, NotRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-				const auto child = rule->getChild();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, UnaryRule& rule, const IN& input) {
+				const auto& child = rule.getChild();
 
 				const OUT currentOut = visitor->visit(child, input);
 				if (this->mixins->isFailure(currentOut)) {
@@ -265,15 +453,14 @@ namespace flock {
 		};
 
 		template<typename IN, typename OUT>
-		class RepeatRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class RepeatRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, RepeatRule, RepeatRuleStrategy<IN, OUT>> {
 		public:
-			RepeatRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			RepeatRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, RepeatRule, RepeatRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<RepeatRule>(baseRule);
-				const auto child = rule->getChild();
-				const int min = rule->getMin();
-				const int max = rule->getMax();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, RepeatRule& rule, const IN& input) {
+				const auto& child = rule.getChild();
+				const int min = rule.getMin();
+				const int max = rule.getMax();
 
 				IN currentIn = input;
 				OUT currentOut = visitor->visit(child, currentIn);
@@ -352,13 +539,12 @@ namespace flock {
 
 
 		template<typename IN, typename OUT>
-		class AnyButRuleStrategy : public LogicRuleStrategy<IN, OUT> {
+		class AnyButRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, UnaryRule, AnyButRuleStrategy<IN, OUT>> {
 		public:
-			AnyButRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : LogicRuleStrategy<IN, OUT>(mixins) {}
+			AnyButRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, UnaryRule, AnyButRuleStrategy<IN, OUT>>(mixins) {}
 
-			virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-				const auto rule = std::dynamic_pointer_cast<UnaryRule>(baseRule);
-				const auto child = rule->getChild();
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, UnaryRule& rule, const IN& input) {
+				const auto& child = rule.getChild();
 
 				const OUT currentOut = visitor->visit(child, input);
 				if (this->mixins->isFailure(currentOut)) {
@@ -372,6 +558,69 @@ namespace flock {
 			}
 		};
 
+		/// <summary>
+		/// Matches the chain, stopping before an operator if no operand follows it, or if the two together match nothing, then folds the outputs of the operands and operators.
+		/// Here they are joined in order, whatever the operators, which is all a recogniser needs, see fold.
+		/// </summary>
+		template<typename IN, typename OUT>
+		class OperatorsRuleStrategy : public TypedLogicRuleStrategy<IN, OUT, OperatorsRule, OperatorsRuleStrategy<IN, OUT>> {
+		public:
+			OperatorsRuleStrategy(_sp<LogicMixinsCombined<IN, OUT>> mixins) : TypedLogicRuleStrategy<IN, OUT, OperatorsRule, OperatorsRuleStrategy<IN, OUT>>(mixins) {}
+
+			OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>& visitor, OperatorsRule& rule, const IN& input) {
+				const auto& children = rule.getChildren();
+				const auto& operand = children.front();
+
+				vector<OUT> operands = { visitor->visit(operand, input) };
+				if (this->mixins->isFailure(operands.back())) {
+					return this->mixins->makeFailure();
+				}
+				// which operator, by where it is in the table, and its output.
+				vector<pair<int, OUT>> operators;
+				IN currentIn = input;
+				while (true) {
+					currentIn = this->mixins->nextInFromPrevious(currentIn, operands.back());
+					int matched = -1;
+					OUT operatorOut = this->mixins->makeFailure();
+					for (size_t i = 1; i < children.size(); i++) {
+						operatorOut = visitor->visit(children[i], currentIn);
+						if (!this->mixins->isFailure(operatorOut)) {
+							matched = static_cast<int>(i) - 1;
+							break;
+						}
+					}
+					if (matched < 0) {
+						break;
+					}
+					const IN operandIn = this->mixins->nextInFromPrevious(currentIn, operatorOut);
+					const OUT operandOut = visitor->visit(operand, operandIn);
+					if (this->mixins->isFailure(operandOut)) {
+						break;
+					}
+					// an operator and an operand that can both match nothing would go round forever, so stop before them.
+					if (!this->mixins->hasMoved(currentIn, this->mixins->nextInFromPrevious(operandIn, operandOut))) {
+						break;
+					}
+					operators.emplace_back(matched, operatorOut);
+					operands.push_back(operandOut);
+					currentIn = operandIn;
+				}
+				return fold(rule, input, operands, operators);
+			}
+
+		protected:
+			/// <summary>
+			/// The output of the whole chain, from that of each operand, and each operator between them.
+			/// </summary>
+			virtual OUT fold(OperatorsRule&, const IN&, const vector<OUT>& operands, const vector<pair<int, OUT>>& operators) {
+				OUT joined = operands.front();
+				for (size_t i = 0; i < operators.size(); i++) {
+					joined = this->mixins->joinOutputs(this->mixins->joinOutputs(joined, operators[i].second), operands[i + 1]);
+				}
+				return joined;
+			}
+		};
+
 		template<typename IN, typename OUT>
 		static void addLogicStrategies(_sp<LogicMixinsCombined<IN, OUT>> mixins, _sp<Strategies<IN, OUT>> strategies) {
 
@@ -389,6 +638,7 @@ namespace flock {
 			strategies->addStrategy(LogicRules::Or, make_shared<OrRuleStrategy<IN, OUT>>(mixins));
 			strategies->addStrategy(LogicRules::And, make_shared<AndRuleStrategy<IN, OUT>>(mixins));
 			strategies->addStrategy(LogicRules::XOr, make_shared<XOrRuleStrategy<IN, OUT>>(mixins));
+			strategies->addStrategy(LogicRules::Operators, make_shared<OperatorsRuleStrategy<IN, OUT>>(mixins));
 		}
 
 		// Terminal Rule
@@ -484,6 +734,28 @@ namespace flock {
 			return make_shared<AliasRule>(alias);
 		}
 
+		/// <summary>
+		/// The operand, with the operators between as many of them as follow, see OperatorsRule.
+		/// </summary>
+		static _sp<Rule> OPERATORS(_sp<Rule> operand, vector<OperatorsRule::Operator> operators) {
+			return make_shared<OperatorsRule>(operand, operators);
+		}
+		static _sp<Rule> OPERATORS(_sp<Rule> operand, initializer_list<OperatorsRule::Operator> operators) {
+			return OPERATORS(operand, vector<OperatorsRule::Operator>(operators));
+		}
+		/// <summary>
+		/// An operator that groups from the left, a - b - c being (a - b) - c.
+		/// </summary>
+		static OperatorsRule::Operator LEFT(const string name, const int precedence, _sp<Rule> rule) {
+			return OperatorsRule::Operator{ name, precedence, Associativity::Left, rule };
+		}
+		/// <summary>
+		/// An operator that groups from the right, a ^ b ^ c being a ^ (b ^ c).
+		/// </summary>
+		static OperatorsRule::Operator RIGHT(const string name, const int precedence, _sp<Rule> rule) {
+			return OperatorsRule::Operator{ name, precedence, Associativity::Right, rule };
+		}
+
 		struct UnwrapAddStrategy : public LibraryAddStrategy {
 			virtual _sp<Rule> addNode(_sp<visitor::Library<Rule>> library, const string name, _sp <Rule> expression) override {
 				string alias = name;
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_MAPPED_SOURCE_H
+#define FLOCK_COMPILER_MAPPED_SOURCE_H
+
+#include "Util.h"
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+// fcntl.h declares a struct flock, which collides with our namespace, so files are opened through stdio.
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace flock {
+	namespace source {
+
+		/// <summary>
+		/// A contiguous, read only run of bytes, owned by someone else.
+		/// </summary>
+		struct ByteSpan {
+			ByteSpan() : data(nullptr), size(0) {}
+			ByteSpan(const char* data, const size_t size) : data(data), size(size) {}
+
+			bool empty() const {
+				return size == 0;
+			}
+			const char* begin() const {
+				return data;
+			}
+			const char* end() const {
+				return data + size;
+			}
+
+			const char* data;
+			size_t size;
+		};
+
+		/// <summary>
+		/// Maps a source file read only, so the evaluator can work directly on the bytes without reading them a character at a time.
+		///
+		/// Files up to maxMapping bytes are mapped in one go, and span() is the whole file.
+		/// Anything larger is mapped a window at a time, spanFrom(offset) moves the window so it covers the offset.
+		/// Spans are only valid while this source is alive, and in the windowed case until the window next moves.
+		/// </summary>
+		class MappedSource {
+		public:
+			// 32 bit address spaces fragment quickly, so be conservative there.
+			static const size_t DEFAULT_MAX_MAPPING = sizeof(void*) >= 8 ? (size_t(1) << 40) : (size_t(256) << 20);
+			static const size_t DEFAULT_WINDOW_SIZE = size_t(16) << 20;
+
+			MappedSource(const string fileName, const size_t maxMapping = DEFAULT_MAX_MAPPING, const size_t windowSize = DEFAULT_WINDOW_SIZE) : fileName(fileName) {
+				open();
+				const size_t granularity = allocationGranularity();
+				// windows must start on the allocation granularity, so keep the size a multiple of it too.
+				windowBytes = std::max(granularity, (windowSize / granularity) * granularity);
+				windowed = fileSize > maxMapping;
+				try {
+					map(0, windowed ? std::min(windowBytes, fileSize) : fileSize);
+				}
+				catch (...) {
+					close();
+					throw;
+				}
+			}
+
+			~MappedSource() {
+				unmap();
+				close();
+			}
+
+			MappedSource(const MappedSource&) = delete;
+			MappedSource& operator=(const MappedSource&) = delete;
+
+			const string getFileName() const {
+				return fileName;
+			}
+
+			/// <summary>
+			/// Size of the whole file, not the current window.
+			/// </summary>
+			size_t size() const {
+				return fileSize;
+			}
+
+			bool isWindowed() const {
+				return windowed;
+			}
+
+			/// <summary>
+			/// The whole file when it is mapped in one go, otherwise the current window.
+			/// </summary>
+			ByteSpan span() const {
+				return ByteSpan(mapped, windowLength);
+			}
+
+			/// <summary>
+			/// The bytes from offset through to the end of the mapping that holds it, moving the window if need be.
+			/// An empty span means the offset is at, or beyond, the end of the file.
+			/// </summary>
+			ByteSpan spanFrom(const size_t offset) {
+				if (offset >= fileSize) {
+					return ByteSpan();
+				}
+				if (offset < windowOffset || offset >= windowOffset + windowLength) {
+					moveWindow(offset);
+				}
+				const size_t skip = offset - windowOffset;
+				return ByteSpan(mapped + skip, windowLength - skip);
+			}
+
+		protected:
+			void moveWindow(const size_t offset) {
+				const size_t start = (offset / windowBytes) * windowBytes;
+				map(start, std::min(windowBytes, fileSize - start));
+			}
+
+#ifdef _WIN32
+			static size_t allocationGranularity() {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return info.dwAllocationGranularity;
+			}
+
+			void open() {
+				file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					throw string("Unable to open " + fileName);
+				}
+				LARGE_INTEGER fileLength;
+				if (!GetFileSizeEx(file, &fileLength)) {
+					close();
+					throw string("Unable to size " + fileName);
+				}
+				fileSize = static_cast<size_t>(fileLength.QuadPart);
+				if (fileSize > 0) {
+					mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+					if (mapping == nullptr) {
+						close();
+						throw string("Unable to map " + fileName);
+					}
+				}
+			}
+
+			void map(const size_t offset, const size_t length) {
+				unmap();
+				if (length == 0) {
+					return;
+				}
+				const uint64_t wideOffset = offset;
+				void* view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(wideOffset >> 32), static_cast<DWORD>(wideOffset & 0xFFFFFFFF), length);
+				if (view == nullptr) {
+					throw string("Unable to map " + fileName);
+				}
+				mapped = static_cast<const char*>(view);
+				windowOffset = offset;
+				windowLength = length;
+			}
+
+			void unmap() {
+				if (mapped) {
+					UnmapViewOfFile(mapped);
+					mapped = nullptr;
+				}
+				windowLength = 0;
+			}
+
+			void close() {
+				if (mapping != nullptr) {
+					CloseHandle(mapping);
+					mapping = nullptr;
+				}
+				if (file != INVALID_HANDLE_VALUE) {
+					CloseHandle(file);
+					file = INVALID_HANDLE_VALUE;
+				}
+			}
+
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = nullptr;
+#else
+			static size_t allocationGranularity() {
+				return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			}
+
+			void open() {
+				file = fopen(fileName.c_str(), "rb");
+				if (file == nullptr) {
+					throw string("Unable to open " + fileName);
+				}
+				struct stat status;
+				if (fstat(fileno(file), &status) != 0) {
+					close();
+					throw string("Unable to size " + fileName);
+				}
+				fileSize = static_cast<size_t>(status.st_size);
+			}
+
+			void map(const size_t offset, const size_t length) {
+				unmap();
+				if (length == 0) {
+					return;
+				}
+				void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileno(file), static_cast<off_t>(offset));
+				if (view == MAP_FAILED) {
+					throw string("Unable to map " + fileName);
+				}
+				// we read front to back, let the kernel read ahead.
+				madvise(view, length, MADV_SEQUENTIAL);
+				mapped = static_cast<const char*>(view);
+				windowOffset = offset;
+				windowLength = length;
+			}
+
+			void unmap() {
+				if (mapped) {
+					munmap(const_cast<char*>(mapped), windowLength);
+					mapped = nullptr;
+				}
+				windowLength = 0;
+			}
+
+			void close() {
+				if (file != nullptr) {
+					fclose(file);
+					file = nullptr;
+				}
+			}
+
+			FILE* file = nullptr;
+#endif
+			const string fileName;
+			size_t fileSize = 0;
+			size_t windowBytes = 0;
+			bool windowed = false;
+			const char* mapped = nullptr;
+			size_t windowOffset = 0;
+			size_t windowLength = 0;
+		};
+	}
+}
+#endif
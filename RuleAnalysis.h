@@ -0,0 +1,503 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_RULE_ANALYSIS_H
+#define FLOCK_COMPILER_RULE_ANALYSIS_H
+
+#include "Util.h"
+#include "Rules.h"
+#include "LogicRules.h"
+#include "StringRules.h"
+#include <bitset>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+ ///
+ /// Works out, for every rule in a library, which characters a match of it can start with, so it need not be tried on any other.
+ ///
+namespace flock {
+	namespace rule {
+		using namespace std;
+		using namespace types;
+		namespace analysis {
+
+			/// <summary>
+			/// The characters a match that moves forward can start with, and whether a match can be empty.
+			/// A rule can only match where the character is one of them, or if it is nullable, and only if it is nullable at the end.
+			/// </summary>
+			struct FirstSet {
+				bitset<256> characters;
+				bool nullable = false;
+
+				bool canStartWith(const int character) const {
+					if (nullable) {
+						return true;
+					}
+					return character != EOF && characters.test(static_cast<unsigned char>(character));
+				}
+
+				/// <summary>
+				/// Whether there is any character it can't start with, otherwise it is no use checking.
+				/// </summary>
+				bool isSelective() const {
+					return !nullable && !characters.all();
+				}
+
+				bool operator==(const FirstSet& other) const {
+					return nullable == other.nullable && characters == other.characters;
+				}
+				bool operator!=(const FirstSet& other) const {
+					return !(*this == other);
+				}
+
+				/// <summary>
+				/// What we know nothing about, which could start with anything, or nothing.
+				/// </summary>
+				static FirstSet anything() {
+					FirstSet set;
+					set.characters.set();
+					set.nullable = true;
+					return set;
+				}
+			};
+
+			/// <summary>
+			/// The first set of every rule in a library, its symbols, its parts and everything under them, by rule id.
+			/// Worked out once, the library shouldn't be added to afterwards, and a rule it never saw can start with anything.
+			///
+			/// Rules refer to each other through aliases, so the sets start empty and are worked out again until none of them change.
+			/// They only ever grow, so that is at most once per character per rule, and in practice a handful of passes.
+			/// Rules of a type it doesn't know, and aliases to rules that don't exist, can start with anything.
+			/// </summary>
+			class FirstSets {
+			public:
+				FirstSets(_sp<RuleLibrary> library) {
+					collect(library);
+					solve();
+				}
+
+				const FirstSet& of(const Rule& rule) const {
+					const size_t id = static_cast<size_t>(rule.id);
+					return id < index.size() && index[id] >= 0 ? sets[index[id]] : unknown;
+				}
+
+				bool canStartWith(const Rule& rule, const int character) const {
+					return of(rule).canStartWith(character);
+				}
+
+				/// <summary>
+				/// The names of the symbols and parts, in the order they were added, symbols first.
+				/// </summary>
+				const vector<string>& getProductionNames() const {
+					return productionNames;
+				}
+
+				/// <summary>
+				/// The symbol or part the rule was found under, by where it is in getProductionNames, -1 if it wasn't found at all.
+				/// A rule shared between them goes with the first.
+				/// </summary>
+				int productionOf(const int ruleId) const {
+					const size_t id = static_cast<size_t>(ruleId);
+					return id < index.size() && index[id] >= 0 ? productions[index[id]] : -1;
+				}
+
+				/// <summary>
+				/// Whether the rule is the whole of a symbol or part, rather than something under one.
+				/// </summary>
+				bool isProduction(const int ruleId) const {
+					const size_t id = static_cast<size_t>(ruleId);
+					return id < index.size() && index[id] >= 0 && roots[index[id]];
+				}
+
+				size_t size() const {
+					return rules.size();
+				}
+
+			protected:
+				/// <summary>
+				/// Every rule under the symbols and parts, each once, and for each alias the rule it names.
+				/// </summary>
+				void collect(const _sp<RuleLibrary>& library) {
+					vector<pair<string, _sp<Rule>>> named;
+					for (const string& name : library->getSymbolNames()) {
+						named.emplace_back(name, library->getSymbol(name));
+					}
+					for (const string& name : library->getPartNames()) {
+						named.emplace_back(name, library->getPart(name));
+					}
+					for (const auto& production : named) {
+						const int owner = static_cast<int>(productionNames.size());
+						productionNames.push_back(production.first);
+						if (!production.second) {
+							continue;
+						}
+						if (add(production.second.get(), owner)) {
+							roots.back() = true;
+						}
+						vector<Rule*> pending = { production.second.get() };
+						while (!pending.empty()) {
+							Rule* rule = pending.back();
+							pending.pop_back();
+							if (UnaryRule* unary = dynamic_cast<UnaryRule*>(rule)) {
+								if (add(unary->getChild().get(), owner)) {
+									pending.push_back(unary->getChild().get());
+								}
+							}
+							else if (CollectionRule* collection = dynamic_cast<CollectionRule*>(rule)) {
+								for (const auto& child : collection->getChildren()) {
+									if (add(child.get(), owner)) {
+										pending.push_back(child.get());
+									}
+								}
+							}
+						}
+					}
+					aliases.assign(rules.size(), -1);
+					for (size_t i = 0; i < rules.size(); i++) {
+						if (AliasRule* alias = dynamic_cast<AliasRule*>(rules[i])) {
+							_sp<Rule> target = alias->isBound() ? alias->getTarget() : library->getSymbol(alias->getAlias());
+							if (!target) {
+								target = library->getPart(alias->getAlias());
+							}
+							aliases[i] = target ? indexOf(*target) : -1;
+						}
+					}
+				}
+
+				/// <summary>
+				/// False if the rule has already been added.
+				/// </summary>
+				bool add(Rule* rule, const int owner) {
+					if (indexOf(*rule) >= 0) {
+						return false;
+					}
+					const size_t id = static_cast<size_t>(rule->id);
+					if (index.size() <= id) {
+						index.resize(id + 1, -1);
+					}
+					index[id] = static_cast<int>(rules.size());
+					rules.push_back(rule);
+					productions.push_back(owner);
+					roots.push_back(false);
+					return true;
+				}
+
+				int indexOf(const Rule& rule) const {
+					const size_t id = static_cast<size_t>(rule.id);
+					return id < index.size() ? index[id] : -1;
+				}
+
+				void solve() {
+					sets.assign(rules.size(), FirstSet());
+					bool changed = true;
+					while (changed) {
+						changed = false;
+						// children are found after their parents, so going backwards mostly sees them first.
+						for (size_t i = rules.size(); i-- > 0;) {
+							const FirstSet set = firstOf(i);
+							if (set != sets[i]) {
+								sets[i] = set;
+								changed = true;
+							}
+						}
+					}
+				}
+
+				FirstSet firstOf(const size_t i) const {
+					Rule* rule = rules[i];
+					FirstSet set;
+					switch (rule->type) {
+					case LogicRules::Any:
+					case LogicRules::AnyBut:
+						set.characters.set();
+						return set;
+					case LogicRules::End:
+					case LogicRules::Not:
+						// match nothing, or fail.
+						set.nullable = true;
+						return set;
+					case LogicRules::Optional:
+						set = of(*static_cast<UnaryRule*>(rule)->getChild());
+						set.nullable = true;
+						return set;
+					case LogicRules::Repeat: {
+						RepeatRule* repeat = static_cast<RepeatRule*>(rule);
+						set = of(*repeat->getChild());
+						set.nullable = set.nullable || repeat->getMin() == 0;
+						return set;
+					}
+					case LogicRules::Alias:
+						return aliases[i] >= 0 ? sets[aliases[i]] : FirstSet::anything();
+					case LogicRules::Sequence:
+						set.nullable = true;
+						for (const auto& child : static_cast<CollectionRule*>(rule)->getChildren()) {
+							const FirstSet& next = of(*child);
+							set.characters |= next.characters;
+							if (!next.nullable) {
+								set.nullable = false;
+								break;
+							}
+						}
+						return set;
+					case LogicRules::Or:
+					case LogicRules::XOr:
+						for (const auto& child : static_cast<CollectionRule*>(rule)->getChildren()) {
+							const FirstSet& next = of(*child);
+							set.characters |= next.characters;
+							set.nullable = set.nullable || next.nullable;
+						}
+						return set;
+					case LogicRules::And:
+						// only the first child moves us forward, the rest are checks.
+						return of(*static_cast<CollectionRule*>(rule)->getChildren().at(0));
+					case LogicRules::Operators: {
+						// the operand, and if that can match nothing, any of the operators after it.
+						const auto& children = static_cast<CollectionRule*>(rule)->getChildren();
+						set = of(*children.front());
+						if (set.nullable) {
+							for (auto child = children.begin() + 1; child != children.end(); ++child) {
+								set.characters |= of(**child).characters;
+							}
+						}
+						return set;
+					}
+					case StringRules::EqualChar:
+						if (ValuesRule<int>* chars = dynamic_cast<ValuesRule<int>*>(rule)) {
+							for (const int value : chars->getValues()) {
+								if (value >= 0 && value < 256) {
+									set.characters.set(value);
+								}
+							}
+							return set;
+						}
+						break;
+					case StringRules::CharRange:
+						if (ValuesRule<int>* range = dynamic_cast<ValuesRule<int>*>(rule)) {
+							for (int value = std::max(range->getValues().at(0), 0); value <= std::min(range->getValues().at(1), 255); value++) {
+								set.characters.set(value);
+							}
+							return set;
+						}
+						break;
+					case StringRules::CharClass:
+						if (CharClassRule* chars = dynamic_cast<CharClassRule*>(rule)) {
+							set.characters = chars->getBytes();
+							// the encoding of a code point starts with a byte that only grows with it, so a range starts with any between those of its ends.
+							for (const pair<int, int>& range : chars->getCodePoints()) {
+								for (int lead = leadByte(range.first); lead <= leadByte(range.second); lead++) {
+									set.characters.set(lead);
+								}
+							}
+							return set;
+						}
+						break;
+					case StringRules::EqualString:
+						if (ValuesRule<string>* strings = dynamic_cast<ValuesRule<string>*>(rule)) {
+							for (const string& value : strings->getValues()) {
+								if (value.empty()) {
+									set.nullable = true;
+								}
+								else {
+									set.characters.set(static_cast<unsigned char>(value[0]));
+								}
+							}
+							return set;
+						}
+						break;
+					}
+					return FirstSet::anything();
+				}
+
+				/// <summary>
+				/// The first byte of the UTF-8 encoding of a code point.
+				/// </summary>
+				static int leadByte(const int codePoint) {
+					if (codePoint < 0x80) {
+						return codePoint;
+					}
+					if (codePoint < 0x800) {
+						return 0xC0 | (codePoint >> 6);
+					}
+					if (codePoint < 0x10000) {
+						return 0xE0 | (codePoint >> 12);
+					}
+					return std::min(0xF0 | (codePoint >> 18), 0xFF);
+				}
+
+				// the rules, in the order they were found, and for each the first set, the alias target, and which symbol or part it is under.
+				vector<Rule*> rules;
+				vector<FirstSet> sets;
+				vector<int> aliases;
+				vector<int> productions;
+				vector<bool> roots;
+				// rule id to where it is in the above, -1 if it isn't.
+				vector<int> index;
+				vector<string> productionNames;
+				const FirstSet unknown = FirstSet::anything();
+			};
+
+			/// <summary>
+			/// Calls visit with every rule under the symbols and parts of a library, each once, however many places it is used in.
+			/// Aliases are visited, not followed.
+			/// </summary>
+			template<typename VISIT>
+			static void forEachRule(const _sp<RuleLibrary>& library, const VISIT& visit) {
+				std::set<Rule*> seen;
+				vector<Rule*> pending;
+				const auto reach = [&seen, &pending](const _sp<Rule>& rule) {
+					if (rule && seen.insert(rule.get()).second) {
+						pending.push_back(rule.get());
+					}
+				};
+				for (const string& name : library->getSymbolNames()) {
+					reach(library->getSymbol(name));
+				}
+				for (const string& name : library->getPartNames()) {
+					reach(library->getPart(name));
+				}
+				while (!pending.empty()) {
+					Rule* rule = pending.back();
+					pending.pop_back();
+					visit(*rule);
+					if (UnaryRule* unary = dynamic_cast<UnaryRule*>(rule)) {
+						reach(unary->getChild());
+					}
+					else if (CollectionRule* collection = dynamic_cast<CollectionRule*>(rule)) {
+						for (const auto& child : collection->getChildren()) {
+							reach(child);
+						}
+					}
+				}
+			}
+
+			/// <summary>
+			/// How many distinct rules make up a library, a rule shared between several places counting once.
+			/// </summary>
+			static size_t countRules(const _sp<RuleLibrary>& library) {
+				size_t count = 0;
+				forEachRule(library, [&count](Rule&) { count++; });
+				return count;
+			}
+
+			/// <summary>
+			/// A byte of 0x80 and up, in with code points, would be taken on its own where an or would have tried the code point first.
+			/// </summary>
+			static bool mergeableCharacters(const bitset<256>& bytes, const vector<pair<int, int>>& codePoints) {
+				if (codePoints.empty()) {
+					return true;
+				}
+				for (int value = 0x80; value < 256; value++) {
+					if (bytes.test(value)) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			/// <summary>
+			/// Adds the characters the rule matches, false if it isn't made only of single characters, so couldn't be one CharClassRule.
+			/// part(name) is what an alias of name stands for, nullptr for a symbol, which makes a node, or for anything that shouldn't be followed.
+			/// </summary>
+			template<typename PART>
+			static bool collectCharacters(const _sp<Rule>& rule, const PART& part, bitset<256>& bytes, vector<pair<int, int>>& codePoints) {
+				switch (rule->type) {
+				case StringRules::EqualChar:
+					for (const int value : static_cast<ValuesRule<int>&>(*rule).getValues()) {
+						// anything else never matches.
+						if (value >= 0 && value < 256) {
+							bytes.set(value);
+						}
+					}
+					return true;
+				case StringRules::CharRange: {
+					const vector<int>& values = static_cast<ValuesRule<int>&>(*rule).getValues();
+					for (int value = std::max(values.at(0), 0); value <= std::min(values.at(1), 255); value++) {
+						bytes.set(value);
+					}
+					return true;
+				}
+				case StringRules::CharClass: {
+					CharClassRule& chars = static_cast<CharClassRule&>(*rule);
+					bytes |= chars.getBytes();
+					codePoints.insert(codePoints.end(), chars.getCodePoints().begin(), chars.getCodePoints().end());
+					return mergeableCharacters(bytes, codePoints);
+				}
+				case LogicRules::Or:
+					for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+						if (!collectCharacters(child, part, bytes, codePoints)) {
+							return false;
+						}
+					}
+					return true;
+				case LogicRules::AnyBut: {
+					// any byte that the rule doesn't match, which a code point, being several, can't say.
+					bitset<256> excluded;
+					vector<pair<int, int>> excludedCodePoints;
+					if (!collectCharacters(static_cast<UnaryRule&>(*rule).getChild(), part, excluded, excludedCodePoints) || !excludedCodePoints.empty()) {
+						return false;
+					}
+					bytes |= ~excluded;
+					return mergeableCharacters(bytes, codePoints);
+				}
+				case LogicRules::Alias: {
+					const _sp<Rule> target = part(static_cast<AliasRule&>(*rule).getAlias());
+					return target && collectCharacters(target, part, bytes, codePoints);
+				}
+				default:
+					return false;
+				}
+			}
+
+			/// <summary>
+			/// Adds the strings and characters the rule matches, each as a literal, false if it isn't made only of them.
+			/// part(name) is what an alias of name stands for, as for collectCharacters.
+			/// </summary>
+			template<typename PART>
+			static bool collectLiterals(const _sp<Rule>& rule, const PART& part, vector<string>& literals) {
+				switch (rule->type) {
+				case StringRules::EqualString: {
+					const vector<string>& values = static_cast<ValuesRule<string>&>(*rule).getValues();
+					literals.insert(literals.end(), values.begin(), values.end());
+					return true;
+				}
+				case StringRules::EqualChar:
+					for (const int value : static_cast<ValuesRule<int>&>(*rule).getValues()) {
+						if (value >= 0 && value < 256) {
+							literals.push_back(string(1, static_cast<char>(value)));
+						}
+					}
+					return true;
+				case LogicRules::Or:
+					for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+						if (!collectLiterals(child, part, literals)) {
+							return false;
+						}
+					}
+					return true;
+				case LogicRules::Alias: {
+					const _sp<Rule> target = part(static_cast<AliasRule&>(*rule).getAlias());
+					return target && collectLiterals(target, part, literals);
+				}
+				default:
+					return false;
+				}
+			}
+		}
+	}
+}
+#endif
@@ -20,6 +20,11 @@
 #include <memory>
 #include <map>
 #include <optional>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+#include <set>
 
  ///
  /// Basic Grammar, that allows to employ basic BNF style grammars in language detection.
@@ -128,84 +133,600 @@ namespace flock {
 
 
 
+			/// <summary>
+			/// What the memo table has been asked, and what it held, over all the rounds since it was made.
+			/// </summary>
+			struct MemoStats {
+				// rules visited by a caching strategy.
+				size_t visits = 0;
+				// visits answered from the table.
+				size_t hits = 0;
+				// outputs stored.
+				size_t stored = 0;
+				// visits the policy left out of the table.
+				size_t transient = 0;
+				// visits the policy only guarded against left recursion.
+				size_t guarded = 0;
+				// the most entries held at once, and the bytes reserved for them.
+				size_t peakEntries = 0;
+				size_t peakBytes = 0;
+
+				double hitRate() const {
+					const size_t looked = visits - transient - guarded;
+					return looked > 0 ? static_cast<double>(hits) / looked : 0;
+				}
+			};
+
+			/// <summary>
+			/// One rule at one position, 16 bytes, and nothing allocated for it.
+			/// </summary>
+			struct MemoEntry {
+				static constexpr uint64_t EMPTY = UINT64_MAX;
+
+				uint64_t key = EMPTY;
+				// index of the completed output, once there is one.
+				uint32_t value = 0;
+				RuleHistoryState state = RuleHistoryState::New;
+			};
+
+			/// <summary>
+			/// The packrat store, what each rule did at each position.
+			///
+			/// The rule id and the position are packed into one 64 bit key, and looked up in a single open addressed table,
+			/// so a lookup is a hash and, normally, one cache line, rather than two map walks and two shared pointers.
+			/// Completed outputs are held to one side, so entries stay small and no record is allocated per lookup.
+			/// </summary>
+			template<typename STORE>
+			class MemoTable {
+			public:
+				static constexpr size_t INITIAL_CAPACITY = 256;
+
+				MemoTable() : entries(INITIAL_CAPACITY) {}
+
+				/// <summary>
+				/// The entry for rule at position, added as New if there isn't one.
+				/// Only good until the next lookup, which may grow the table.
+				/// </summary>
+				MemoEntry& lookup(const int ruleId, const int position) {
+					const uint64_t key = pack(ruleId, position);
+					size_t slot = probe(key);
+					if (entries[slot].key == MemoEntry::EMPTY) {
+						if ((count + 1) * 2 > entries.size()) {
+							grow();
+							slot = probe(key);
+						}
+						entries[slot].key = key;
+						count++;
+					}
+					return entries[slot];
+				}
+
+				/// <summary>
+				/// The entry for rule at position, or nullptr if there isn't one, without adding it.
+				/// </summary>
+				const MemoEntry* find(const int ruleId, const int position) const {
+					const MemoEntry& entry = entries[probe(pack(ruleId, position))];
+					return entry.key == MemoEntry::EMPTY ? nullptr : &entry;
+				}
+
+				const STORE& getCompleted(const MemoEntry& entry) const {
+					return values[entry.value];
+				}
+
+				void setCompleted(const int ruleId, const int position, const STORE& output) {
+					MemoEntry& entry = lookup(ruleId, position);
+					entry.value = static_cast<uint32_t>(values.size());
+					entry.state = RuleHistoryState::Completed;
+					values.push_back(output);
+					stats.stored++;
+				}
+
+				/// <summary>
+				/// Counted by the caching strategy, which knows why it did or didn't look.
+				/// </summary>
+				MemoStats& counters() {
+					return stats;
+				}
+
+				MemoStats& getStats() {
+					stats.peakEntries = std::max(stats.peakEntries, count);
+					stats.peakBytes = getPeakBytes();
+					return stats;
+				}
+
+				/// <summary>
+				/// How many rule and position pairs are held.
+				/// </summary>
+				size_t size() const {
+					return count;
+				}
+
+				/// <summary>
+				/// Bytes reserved for the entries and outputs, not counting what the outputs themselves point to.
+				/// </summary>
+				size_t memoryBytes() const {
+					return entries.capacity() * sizeof(MemoEntry) + values.capacity() * sizeof(STORE);
+				}
+
+				size_t getPeakBytes() const {
+					return std::max(peakBytes, memoryBytes());
+				}
+
+				/// <summary>
+				/// Forgets everything, and gives back the room if it was much bigger than this round needed.
+				/// </summary>
+				void clear() {
+					peakBytes = getPeakBytes();
+					stats.peakEntries = std::max(stats.peakEntries, count);
+					if (count == 0) {
+						return;
+					}
+					if (count * 8 < entries.size() && entries.size() > INITIAL_CAPACITY) {
+						entries = std::vector<MemoEntry>(std::max(INITIAL_CAPACITY, roundUp(count * 4)));
+					}
+					else {
+						std::fill(entries.begin(), entries.end(), MemoEntry());
+					}
+					values.clear();
+					count = 0;
+				}
+
+			protected:
+				static uint64_t pack(const int ruleId, const int position) {
+					return (static_cast<uint64_t>(static_cast<uint32_t>(ruleId)) << 32) | static_cast<uint32_t>(position);
+				}
+
+				static size_t roundUp(const size_t amount) {
+					size_t capacity = 1;
+					while (capacity < amount) {
+						capacity <<= 1;
+					}
+					return capacity;
+				}
+
+				/// <summary>
+				/// The slot holding key, or the empty one it would go in.
+				/// </summary>
+				size_t probe(const uint64_t key) const {
+					const size_t mask = entries.size() - 1;
+					// fibonacci hashing spreads the sequential positions and ids over the table.
+					size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+					while (entries[slot].key != key && entries[slot].key != MemoEntry::EMPTY) {
+						slot = (slot + 1) & mask;
+					}
+					return slot;
+				}
+
+				void grow() {
+					peakBytes = getPeakBytes();
+					std::vector<MemoEntry> old(entries.size() * 2);
+					old.swap(entries);
+					for (const MemoEntry& entry : old) {
+						if (entry.key != MemoEntry::EMPTY) {
+							entries[probe(entry.key)] = entry;
+						}
+					}
+				}
+
+				// always a power of two, and never more than half full.
+				std::vector<MemoEntry> entries;
+				std::vector<STORE> values;
+				size_t count = 0;
+				size_t peakBytes = 0;
+				MemoStats stats;
+			};
+
+			/// <summary>
+			/// What a caching strategy does with a rule.
+			/// </summary>
+			enum class MemoChoice : uint8_t {
+				// visited as if there were no table.
+				Transient,
+				// not stored, but a second visit at the same position, while the first is still going, fails, so left recursion still ends.
+				Guard,
+				// stored, and answered from the table from then on.
+				Memoise
+			};
+
+			enum class MemoMode {
+				// every rule, the way it always was.
+				All,
+				// the rules added as symbols and parts, what Rats! would call the non-transient productions, everything inside them is re-run.
+				Productions,
+				// only the rules added as symbols, parts are guarded.
+				Symbols,
+				// only the rules picked by id or name, other symbols and parts are guarded.
+				Selected
+			};
+
+			/// <summary>
+			/// When an adaptive policy gives up on remembering a rule, and when it takes it back.
+			/// </summary>
+			struct MemoCostModel {
+				// stores a rule makes before it is judged.
+				size_t warmUp = 64;
+				// hits per store below which a rule is not worth its inserts.
+				double minReuse = 0.1;
+				// visits a switched off rule makes before it is judged again.
+				size_t window = 1024;
+				// visits, out of a window, that went back to a position the rule was just run at, above which it is switched back on.
+				// well above what turns it off, so a rule doesn't flip back and forth.
+				double maxReevaluation = 0.5;
+			};
+
+			/// <summary>
+			/// How a rule has been doing, for an adaptive policy.
+			/// </summary>
+			struct RuleAdaptation {
+				static constexpr int RECENT = 4;
+
+				bool off = false;
+				size_t hits = 0;
+				size_t stores = 0;
+				// while off.
+				size_t visits = 0;
+				size_t reevaluations = 0;
+				// the last few positions it was run at while off, a repeat is a re-evaluation the table would have saved.
+				int recent[RECENT] = { -1, -1, -1, -1 };
+				int next = 0;
+			};
+
+			/// <summary>
+			/// What an adaptive policy decided.
+			/// </summary>
+			struct AdaptationStats {
+				size_t switchedOff = 0;
+				size_t switchedOn = 0;
+				// visits to rules that were switched off at the time.
+				size_t offVisits = 0;
+			};
+
+			/// <summary>
+			/// Which rules are worth remembering.
+			/// A terminal, or a sequence inside a production, costs less to run again than to look up and store,
+			/// so by default only whole productions are remembered.
+			/// Rules are classified by id the first time a library is seen, so choosing is an index into a vector.
+			/// </summary>
+			class MemoPolicy {
+			public:
+				MemoPolicy(const MemoMode mode, const std::set<int> ruleIds = {}, const std::set<string> ruleNames = {}) : mode(mode), ruleIds(ruleIds), ruleNames(ruleNames) {}
+
+				/// <summary>
+				/// Left to itself the policy never changes its mind.
+				/// Made adaptive, a rule it would remember is only guarded once its hits fall below what its stores cost,
+				/// and is remembered again if it starts being re-run at the same positions.
+				/// </summary>
+				void adapt(const MemoCostModel& model = MemoCostModel()) {
+					adaptive = true;
+					costModel = model;
+				}
+
+				bool isAdaptive() {
+					return adaptive;
+				}
+
+				MemoChoice choose(const _sp<RuleLibrary>& library, const int ruleId, const int position) {
+					const MemoChoice choice = choose(library, ruleId);
+					if (!adaptive || choice != MemoChoice::Memoise) {
+						return choice;
+					}
+					RuleAdaptation& rule = adaptationFor(ruleId);
+					if (!rule.off) {
+						return choice;
+					}
+					adaptationStats.offVisits++;
+					for (const int recent : rule.recent) {
+						if (recent == position) {
+							rule.reevaluations++;
+							break;
+						}
+					}
+					rule.recent[rule.next] = position;
+					rule.next = (rule.next + 1) % RuleAdaptation::RECENT;
+					if (++rule.visits >= costModel.window) {
+						if (rule.reevaluations > costModel.maxReevaluation * rule.visits) {
+							rule = RuleAdaptation();
+							adaptationStats.switchedOn++;
+							return MemoChoice::Memoise;
+						}
+						rule.visits = 0;
+						rule.reevaluations = 0;
+					}
+					// still guarded, it may be what ends a left recursion.
+					return MemoChoice::Guard;
+				}
+
+				void hit(const int ruleId) {
+					if (adaptive) {
+						adaptationFor(ruleId).hits++;
+					}
+				}
+
+				void stored(const int ruleId) {
+					if (!adaptive) {
+						return;
+					}
+					RuleAdaptation& rule = adaptationFor(ruleId);
+					if (++rule.stores >= costModel.warmUp) {
+						if (rule.hits < costModel.minReuse * rule.stores) {
+							rule = RuleAdaptation();
+							rule.off = true;
+							adaptationStats.switchedOff++;
+						}
+						else {
+							// judged on what it has done lately, not since the start.
+							rule.hits = 0;
+							rule.stores = 0;
+						}
+					}
+				}
+
+				const AdaptationStats& getAdaptationStats() {
+					return adaptationStats;
+				}
+
+				/// <summary>
+				/// The symbols and parts an adaptive policy has currently stopped remembering.
+				/// </summary>
+				vector<string> getSwitchedOff() {
+					vector<string> names;
+					if (!bound) {
+						return names;
+					}
+					for (const string& name : bound->getSymbolNames()) {
+						if (isOff(bound->getSymbol(name)->id)) {
+							names.push_back(name);
+						}
+					}
+					for (const string& name : bound->getPartNames()) {
+						if (isOff(bound->getPart(name)->id)) {
+							names.push_back(name);
+						}
+					}
+					return names;
+				}
+
+				MemoMode getMode() {
+					return mode;
+				}
+
+				static string modeName(const MemoMode mode) {
+					switch (mode) {
+					case MemoMode::All:
+						return "all";
+					case MemoMode::Productions:
+						return "productions";
+					case MemoMode::Symbols:
+						return "symbols";
+					default:
+						return "selected";
+					}
+				}
+
+			protected:
+				MemoChoice choose(const _sp<RuleLibrary>& library, const int ruleId) {
+					if (mode == MemoMode::All) {
+						return MemoChoice::Memoise;
+					}
+					if (library != bound) {
+						bind(library);
+					}
+					return static_cast<size_t>(ruleId) < choices.size() ? choices[ruleId] : MemoChoice::Transient;
+				}
+
+				RuleAdaptation& adaptationFor(const int ruleId) {
+					if (adaptations.size() <= static_cast<size_t>(ruleId)) {
+						adaptations.resize(ruleId + 1);
+					}
+					return adaptations[ruleId];
+				}
+
+				bool isOff(const int ruleId) {
+					return static_cast<size_t>(ruleId) < adaptations.size() && adaptations[ruleId].off;
+				}
+
+				void bind(const _sp<RuleLibrary>& library) {
+					bound = library;
+					choices.clear();
+					for (const int id : ruleIds) {
+						set(id, MemoChoice::Memoise);
+					}
+					for (const string& name : library->getSymbolNames()) {
+						classify(name, library->getSymbol(name), mode == MemoMode::Selected ? MemoChoice::Guard : MemoChoice::Memoise);
+					}
+					for (const string& name : library->getPartNames()) {
+						classify(name, library->getPart(name), mode == MemoMode::Productions ? MemoChoice::Memoise : MemoChoice::Guard);
+					}
+				}
+
+				void classify(const string& name, const _sp<Rule>& rule, const MemoChoice choice) {
+					const bool picked = ruleNames.count(name) > 0 || ruleIds.count(rule->id) > 0;
+					set(rule->id, picked ? MemoChoice::Memoise : choice);
+				}
+
+				void set(const int ruleId, const MemoChoice choice) {
+					if (ruleId < 0) {
+						return;
+					}
+					if (choices.size() <= static_cast<size_t>(ruleId)) {
+						choices.resize(ruleId + 1, MemoChoice::Transient);
+					}
+					choices[ruleId] = choice;
+				}
+
+				const MemoMode mode;
+				const std::set<int> ruleIds;
+				const std::set<string> ruleNames;
+				_sp<RuleLibrary> bound;
+				// indexed by rule id.
+				std::vector<MemoChoice> choices;
+				bool adaptive = false;
+				MemoCostModel costModel;
+				// indexed by rule id.
+				std::vector<RuleAdaptation> adaptations;
+				AdaptationStats adaptationStats;
+			};
+
+			static _sp<MemoPolicy> memoiseAll() {
+				return make_shared<MemoPolicy>(MemoMode::All);
+			}
+			static _sp<MemoPolicy> memoiseProductions() {
+				return make_shared<MemoPolicy>(MemoMode::Productions);
+			}
+			static _sp<MemoPolicy> memoiseSymbols() {
+				return make_shared<MemoPolicy>(MemoMode::Symbols);
+			}
+			static _sp<MemoPolicy> memoiseSelected(const std::set<int> ruleIds, const std::set<string> ruleNames) {
+				return make_shared<MemoPolicy>(MemoMode::Selected, ruleIds, ruleNames);
+			}
+
 			template<typename IN, typename OUT, typename KEY = IN>
-			class HistoryMixinsCombined : public BaseMixinsCombined<IN, OUT> {
+			class HistoryMixinsCombined : public virtual BaseMixinsCombined<IN, OUT> {
 			public:
-				virtual KEY getKeyForInput(IN input) = 0;
+				virtual KEY getKeyForInput(const IN& input) = 0;
 			};
 
 			/// <summary>
 			/// Sometime we may just want to wrap a strategy, to implement common functionality, for instance history.
+			/// The key for an input is its position, so it has to be a whole number.
 			/// </summary>
 			/// <param name="rule"></param>
 			/// <param name="input"></param>
 			/// <returns></returns>
 			template<typename IN, typename OUT, typename KEY = IN>
 			class CachingRuleStrategy : public  WrappingRuleStrategy<IN, OUT> {
+				static_assert(std::is_integral<KEY>::value, "memo tables are keyed by position");
 			public:
-				CachingRuleStrategy(_sp<RuleHistories<KEY, OUT>> histories, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins, _sp<RuleStrategy <IN, OUT>> wrapped) : WrappingRuleStrategy<IN, OUT>(wrapped), histories(histories), mixins(mixins) {}
+				CachingRuleStrategy(_sp<MemoTable<OUT>> memo, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins, _sp<RuleStrategy <IN, OUT>> wrapped) : WrappingRuleStrategy<IN, OUT>(wrapped), memo(memo), policy(policy), mixins(mixins) {}
 
 				virtual OUT accept(_sp<RuleVisitor<IN, OUT>> visitor, _sp<Rule> baseRule, IN input) override {
-					_sp<RuleHistory<const KEY, OUT>> ruleHistory = histories->getRecords(baseRule->id);
-					const KEY key = mixins->getKeyForInput(input);
-					_sp<HistoryRecord<OUT>> record = ruleHistory->getRecord(key);
-					if (record->isCompleted()) {
-						return record->getCompleted();
-					}
-					if (record->isProcessing()) {
-						record->setCyclic();
-						return this->mixins->makeFailure();
+					const int ruleId = baseRule->id;
+					MemoStats& stats = memo->counters();
+					stats.visits++;
+					const int key = static_cast<int>(mixins->getKeyForInput(input));
+					const MemoChoice choice = policy->choose(visitor->getLibrary(), ruleId, key);
+					if (choice == MemoChoice::Transient) {
+						stats.transient++;
+						return this->wrapped->accept(visitor, baseRule, input);
+					}
+					if (choice == MemoChoice::Guard) {
+						stats.guarded++;
+						return guard(visitor, baseRule, input, ruleId, key);
 					}
-					if (record->isCyclic()) {
+					MemoEntry& entry = memo->lookup(ruleId, key);
+					switch (entry.state) {
+					case RuleHistoryState::Completed:
+						stats.hits++;
+						policy->hit(ruleId);
+						return memo->getCompleted(entry);
+					case RuleHistoryState::Processing:
+						entry.state = RuleHistoryState::Cyclic;
 						return this->mixins->makeFailure();
+					case RuleHistoryState::Cyclic:
+						return this->mixins->makeFailure();
+					default:
+						// an adaptive policy may have switched the rule back on while it was guarded, further out, at this position.
+						if (isGuarded(ruleId, key)) {
+							return this->mixins->makeFailure();
+						}
+						entry.state = RuleHistoryState::Processing;
 					}
-					record->setProcessing();
 					OUT output = this->wrapped->accept(visitor, baseRule, input);
-					record->setCompleted(output);
+					// the entry may have moved while the rule was visited.
+					memo->setCompleted(ruleId, key, output);
+					policy->stored(ruleId);
 					return output;
 				}
 
 			protected:
-				_sp<RuleHistories<KEY, OUT>> histories;
+				/// <summary>
+				/// Runs the rule, unless it is already running at this position, which is left recursion, and fails.
+				/// Rules in progress are few, so they are kept on a stack rather than in the table.
+				/// An adaptive policy can switch a rule off while it is being remembered further out, so one running from the table counts too.
+				/// </summary>
+				OUT guard(const _sp<RuleVisitor<IN, OUT>>& visitor, const _sp<Rule>& baseRule, const IN& input, const int ruleId, const int key) {
+					if (isGuarded(ruleId, key)) {
+						return this->mixins->makeFailure();
+					}
+					const MemoEntry* remembered = memo->find(ruleId, key);
+					if (remembered && (remembered->state == RuleHistoryState::Processing || remembered->state == RuleHistoryState::Cyclic)) {
+						return this->mixins->makeFailure();
+					}
+					active.emplace_back(ruleId, key);
+					try {
+						OUT output = this->wrapped->accept(visitor, baseRule, input);
+						active.pop_back();
+						return output;
+					}
+					catch (...) {
+						active.pop_back();
+						throw;
+					}
+				}
+
+				bool isGuarded(const int ruleId, const int key) const {
+					for (const auto& running : active) {
+						if (running.first == ruleId && running.second == key) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+				_sp<MemoTable<OUT>> memo;
+				_sp<MemoPolicy> policy;
 				_sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins;
+				std::vector<std::pair<int, int>> active;
 			};
 
 
 			template<typename IN, typename OUT, typename KEY = IN>
-			_sp<CachingRuleStrategy<IN, OUT, KEY>> cacheResult(_sp<RuleHistories<KEY, OUT>> histories, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins, _sp<RuleStrategy<IN, OUT>> strategy) {
-				return make_shared<CachingRuleStrategy<IN, OUT, KEY>>(histories, mixins, strategy);
+			_sp<CachingRuleStrategy<IN, OUT, KEY>> cacheResult(_sp<MemoTable<OUT>> memo, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins, _sp<RuleStrategy<IN, OUT>> strategy) {
+				return make_shared<CachingRuleStrategy<IN, OUT, KEY>>(memo, policy, mixins, strategy);
 			}
 
 
 			template<typename IN, typename OUT, typename KEY = IN>
 			class CachingStrategies : public WrappingStrategies<IN, OUT> {
 			public:
-				CachingStrategies(_sp<Strategies<IN, OUT>> strategies, _sp<RuleHistories<KEY, OUT>> histories, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) :
+				CachingStrategies(_sp<Strategies<IN, OUT>> strategies, _sp<MemoTable<OUT>> memo, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) :
 					WrappingStrategies<IN, OUT>(strategies),
-					histories(histories), mixins(mixins) {}
+					memo(memo), policy(policy), mixins(mixins) {}
+
+				CachingStrategies(_sp<Strategies<IN, OUT>> strategies, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) :
+					CachingStrategies(strategies, make_shared<MemoTable<OUT>>(), policy, mixins) {}
 
 				CachingStrategies(_sp<Strategies<IN, OUT>> strategies, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) :
-					CachingStrategies(strategies, make_shared<RuleHistories<KEY, OUT>>(), mixins) {}
+					CachingStrategies(strategies, memoiseProductions(), mixins) {}
 
 				virtual void addStrategy(const int type, _sp<RuleStrategy<IN, OUT>> strategy) override {
-					getWrappedStratagies()->addStrategy(type, cacheResult<IN, OUT, KEY>(histories, mixins, strategy));
+					this->getWrappedStratagies()->addStrategy(type, cacheResult<IN, OUT, KEY>(memo, policy, mixins, strategy));
 				}
-				_sp<RuleHistories<KEY, OUT>> getHistories() {
-					return histories;
+				_sp<MemoTable<OUT>> getMemo() {
+					return memo;
+				}
+				_sp<MemoPolicy> getPolicy() {
+					return policy;
 				}
 
 				virtual void clear() override {
-					histories->clear();
+					memo->clear();
 					WrappingStrategies<IN, OUT>::clear();
 				}
 			protected:
-				_sp<RuleHistories<KEY, OUT>> histories;
+				_sp<MemoTable<OUT>> memo;
+				_sp<MemoPolicy> policy;
 				_sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins;
 			};
 
 			template<typename IN, typename OUT, typename KEY = IN>
-			static _sp<CachingStrategies<IN, OUT, KEY>> cache(_sp<Strategies<IN, OUT>> strategies, _sp<RuleHistories<KEY, OUT>> histories, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) {
-				return make_shared<CachingStrategies<IN, OUT, KEY>>(strategies, histories, mixins);
+			static _sp<CachingStrategies<IN, OUT, KEY>> cache(_sp<Strategies<IN, OUT>> strategies, _sp<MemoTable<OUT>> memo, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) {
+				return make_shared<CachingStrategies<IN, OUT, KEY>>(strategies, memo, policy, mixins);
+			}
+
+			template<typename IN, typename OUT, typename KEY = IN>
+			static _sp<CachingStrategies<IN, OUT, KEY>> cache(_sp<Strategies<IN, OUT>> strategies, _sp<MemoPolicy> policy, _sp<HistoryMixinsCombined<IN, OUT, KEY>> mixins) {
+				return make_shared<CachingStrategies<IN, OUT, KEY>>(strategies, policy, mixins);
 			}
 
 			template<typename IN, typename OUT, typename KEY = IN>
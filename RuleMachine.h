@@ -0,0 +1,750 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_RULE_MACHINE_H
+#define FLOCK_COMPILER_RULE_MACHINE_H
+
+#include "Util.h"
+#include "Rules.h"
+#include "LogicRules.h"
+#include "StringRules.h"
+#include "SourceEvaluation.h"
+#include "SyntaxTree.h"
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+ ///
+ /// Compiles a rule library down to instructions for a small backtracking machine, in the style of LPeg,
+ /// so evaluation doesn't have to walk the rule graph through the visitor.
+ ///
+ /// It gives the same syntax nodes as evaluationStrategies(), with two differences that only show up in grammars that never finished before:
+ /// a repeat whose rule matches nothing stops, rather than going round forever,
+ /// and nothing is remembered between rules, so a rule evaluated while a left recursive one was failing is evaluated again when it is next needed.
+ ///
+namespace flock {
+	namespace rule {
+		using namespace std;
+		using namespace types;
+		namespace machine {
+			using namespace evaluator;
+
+			enum class OpCode : uint8_t {
+				// match a character, a set of characters, a class with code points in it, a string, the longest of several, anything, or the end.
+				Char,
+				Set,
+				Class,
+				String,
+				Strings,
+				Any,
+				End,
+				// skip over a run of a set of characters, or up to a literal, however long, which never fails.
+				Span,
+				// backtracking, a choice remembers where to go should anything after it fail.
+				Choice,
+				Commit,
+				PartialCommit,
+				BackCommit,
+				FailTwice,
+				Fail,
+				Jump,
+				// calls into the library.
+				Call,
+				Return,
+				OpenCapture,
+				CloseCapture,
+				Halt
+			};
+
+			/// <summary>
+			/// What arg means depends on the code, a character, a set, a class, a string, a trie, a span, a rule, a capture name, or where to jump to.
+			/// </summary>
+			struct Instruction {
+				OpCode code;
+				int arg;
+			};
+
+			/// <summary>
+			/// A library entry, compiled once however many times it is referenced.
+			/// </summary>
+			struct Subroutine {
+				string name;
+				int start;
+			};
+
+			/// <summary>
+			/// Everything the machine needs to run a library.
+			/// </summary>
+			struct Program {
+				vector<Instruction> code;
+				vector<bitset<256>> sets;
+				vector<_sp<CharClassRule>> classes;
+				vector<_sp<evaluator::CharacterSpan>> spans;
+				vector<string> strings;
+				vector<_sp<StringTrie>> tries;
+				vector<string> captureNames;
+				vector<Subroutine> subroutines;
+				// the symbols in the order the library tries them, and where each starts.
+				vector<string> symbolNames;
+				vector<int> symbolEntries;
+				// aliases that don't name anything, they always fail.
+				vector<string> missing;
+			};
+
+			/// <summary>
+			/// Turns the rules of a library into a program.
+			/// Logic, string and character rules are understood, anything else throws, as do operators,
+			/// whose nodes can only be nested once the whole chain is known, after the captures of the operands would have been opened,
+			/// so machineStrategies() doesn't compile a library that has any.
+			/// </summary>
+			class RuleCompiler {
+			public:
+				RuleCompiler(_sp<RuleLibrary> library) : library(library), program(make_shared<Program>()) {}
+
+				_sp<Program> compile() {
+					for (const string& name : library->getSymbolNames()) {
+						const int subroutine = subroutineFor(name, library->getSymbol(name));
+						program->symbolNames.push_back(name);
+						program->symbolEntries.push_back(static_cast<int>(program->code.size()));
+						emit(OpCode::Call, subroutine);
+						emit(OpCode::Halt);
+					}
+					// bodies are compiled after, as they are referenced, so the code for one entry is never split by another.
+					for (size_t next = 0; next < pending.size(); next++) {
+						program->subroutines[pending[next].first].start = static_cast<int>(program->code.size());
+						compileRule(pending[next].second);
+						emit(OpCode::Return);
+					}
+					return program;
+				}
+
+			protected:
+				int emit(const OpCode code, const int arg = 0) {
+					program->code.push_back(Instruction{ code, arg });
+					return static_cast<int>(program->code.size()) - 1;
+				}
+
+				int here() {
+					return static_cast<int>(program->code.size());
+				}
+
+				void patch(const int at, const int target) {
+					program->code[at].arg = target;
+				}
+
+				int subroutineFor(const string& name, _sp<Rule> rule) {
+					auto it = subroutines.find(rule.get());
+					if (it != subroutines.end()) {
+						return it->second;
+					}
+					const int index = static_cast<int>(program->subroutines.size());
+					program->subroutines.push_back(Subroutine{ name, -1 });
+					subroutines.emplace(rule.get(), index);
+					pending.push_back({ index, rule });
+					return index;
+				}
+
+				int captureName(const string& name) {
+					auto it = captureNames.find(name);
+					if (it != captureNames.end()) {
+						return it->second;
+					}
+					const int index = static_cast<int>(program->captureNames.size());
+					program->captureNames.push_back(name);
+					captureNames.emplace(name, index);
+					return index;
+				}
+
+				int set(const bitset<256>& characters) {
+					program->sets.push_back(characters);
+					return static_cast<int>(program->sets.size()) - 1;
+				}
+
+				void compileRule(_sp<Rule> rule) {
+					switch (rule->type) {
+					case LogicRules::Any:
+						emit(OpCode::Any);
+						return;
+					case LogicRules::End:
+						emit(OpCode::End);
+						return;
+					case LogicRules::Not:
+						compileNot(std::dynamic_pointer_cast<UnaryRule>(rule)->getChild());
+						return;
+					case LogicRules::AnyBut:
+						compileNot(std::dynamic_pointer_cast<UnaryRule>(rule)->getChild());
+						emit(OpCode::Any);
+						return;
+					case LogicRules::Optional:
+						compileOptional(std::dynamic_pointer_cast<UnaryRule>(rule)->getChild());
+						return;
+					case LogicRules::Repeat:
+						compileRepeat(std::dynamic_pointer_cast<RepeatRule>(rule));
+						return;
+					case LogicRules::Alias:
+						compileAlias(std::dynamic_pointer_cast<AliasRule>(rule)->getAlias());
+						return;
+					case LogicRules::Sequence:
+						for (auto child : std::dynamic_pointer_cast<CollectionRule>(rule)->getChildren()) {
+							compileRule(child);
+						}
+						return;
+					case LogicRules::Or:
+						compileOr(std::dynamic_pointer_cast<CollectionRule>(rule)->getChildren(), 0);
+						return;
+					case LogicRules::And:
+						compileAnd(std::dynamic_pointer_cast<CollectionRule>(rule)->getChildren());
+						return;
+					case LogicRules::XOr:
+						compileXOr(std::dynamic_pointer_cast<CollectionRule>(rule)->getChildren());
+						return;
+					case StringRules::EqualChar:
+						compileChars(std::dynamic_pointer_cast<ValuesRule<int>>(rule)->getValues());
+						return;
+					case StringRules::CharRange:
+						compileRange(std::dynamic_pointer_cast<ValuesRule<int>>(rule)->getValues());
+						return;
+					case StringRules::CharClass:
+						compileClass(std::dynamic_pointer_cast<CharClassRule>(rule));
+						return;
+					case StringRules::EqualString:
+						compileStrings(std::dynamic_pointer_cast<ValuesRule<string>>(rule)->getValues());
+						return;
+					case LogicRules::Operators:
+						throw string("Unable to compile the operators of rule " + to_string(rule->id) + ", only the strategies that walk the rules nest them");
+					default:
+						throw string("Unable to compile rules of type " + to_string(rule->type));
+					}
+				}
+
+				/// <summary>
+				/// Symbols capture what they match, parts don't, anything else is missing and fails.
+				/// </summary>
+				void compileAlias(const string& name) {
+					_sp<Rule> symbol = library->getSymbol(name);
+					if (symbol) {
+						const int capture = captureName(name);
+						emit(OpCode::OpenCapture, capture);
+						emit(OpCode::Call, subroutineFor(name, symbol));
+						emit(OpCode::CloseCapture, capture);
+						return;
+					}
+					_sp<Rule> part = library->getPart(name);
+					if (part) {
+						emit(OpCode::Call, subroutineFor(name, part));
+						return;
+					}
+					program->missing.push_back(name);
+					emit(OpCode::Fail);
+				}
+
+				// Choice L; p; FailTwice; L:
+				void compileNot(_sp<Rule> child) {
+					const int choice = emit(OpCode::Choice);
+					compileRule(child);
+					emit(OpCode::FailTwice);
+					patch(choice, here());
+				}
+
+				// Choice L; p; BackCommit M; L: Fail; M:
+				void compileAndPredicate(_sp<Rule> child) {
+					const int choice = emit(OpCode::Choice);
+					compileRule(child);
+					const int backCommit = emit(OpCode::BackCommit);
+					patch(choice, here());
+					emit(OpCode::Fail);
+					patch(backCommit, here());
+				}
+
+				// Choice L; p; Commit L; L:
+				void compileOptional(_sp<Rule> child) {
+					const int choice = emit(OpCode::Choice);
+					compileRule(child);
+					const int commit = emit(OpCode::Commit);
+					patch(choice, here());
+					patch(commit, here());
+				}
+
+				// Choice L1; a; Commit E; L1: Choice L2; b; Commit E; L2: c; E:
+				void compileOr(const _sp_vec<Rule>& children, const size_t from) {
+					vector<int> commits;
+					for (size_t i = from; i + 1 < children.size(); i++) {
+						const int choice = emit(OpCode::Choice);
+						compileRule(children[i]);
+						commits.push_back(emit(OpCode::Commit));
+						patch(choice, here());
+					}
+					compileRule(children.back());
+					for (int commit : commits) {
+						patch(commit, here());
+					}
+				}
+
+				/// <summary>
+				/// Every other child has to match where the first does, but only the first is kept.
+				/// They have no side effects, so it does no harm to check the others first.
+				/// </summary>
+				void compileAnd(const _sp_vec<Rule>& children) {
+					for (size_t i = 1; i < children.size(); i++) {
+						compileAndPredicate(children[i]);
+					}
+					compileRule(children.front());
+				}
+
+				/// <summary>
+				/// If the first child matches, none of the others may where it started, otherwise the first of the others that matches.
+				/// Choice L1; first; BackCommit L2; L1: others; Jump E; L2: !others; first; E:
+				/// </summary>
+				void compileXOr(const _sp_vec<Rule>& children) {
+					if (children.size() == 1) {
+						compileRule(children.front());
+						return;
+					}
+					const int choice = emit(OpCode::Choice);
+					compileRule(children.front());
+					const int backCommit = emit(OpCode::BackCommit);
+					patch(choice, here());
+					compileOr(children, 1);
+					const int jump = emit(OpCode::Jump);
+					patch(backCommit, here());
+					const int notChoice = emit(OpCode::Choice);
+					compileOr(children, 1);
+					emit(OpCode::FailTwice);
+					patch(notChoice, here());
+					compileRule(children.front());
+					patch(jump, here());
+				}
+
+				/// <summary>
+				/// Follows RepeatRuleStrategy exactly.
+				/// With a maximum, the match fails should there be more repeats available than it allows,
+				/// which, as the first match is counted separately, is max + 1 when min is 0.
+				/// One with no maximum over a class of bytes, or up to a literal, is its minimum, then a Span for the rest.
+				/// </summary>
+				void compileRepeat(_sp<RepeatRule> rule) {
+					const _sp<Rule> child = rule->getChild();
+					const int min = rule->getMin();
+					const int max = rule->getMax();
+					const _sp<evaluator::CharacterSpan> span = evaluator::CharacterSpans::find(library, *rule);
+					for (int i = 0; i < min; i++) {
+						compileRule(child);
+					}
+					if (span) {
+						program->spans.push_back(span);
+						emit(OpCode::Span, static_cast<int>(program->spans.size()) - 1);
+						return;
+					}
+					if (max == 0) {
+						// Choice E; L: p; PartialCommit L; E:
+						const int choice = emit(OpCode::Choice);
+						const int loop = here();
+						compileRule(child);
+						emit(OpCode::PartialCommit, loop);
+						patch(choice, here());
+						return;
+					}
+					const int tries = min == 0 ? max + 1 : max + 1 - min;
+					if (tries <= 0) {
+						emit(OpCode::Fail);
+						return;
+					}
+					// the first match, when it is optional, and all but the last try, stop at the first that fails.
+					vector<int> exits;
+					const int optional = (min == 0 ? 1 : 0) + tries - 1;
+					for (int i = 0; i < optional; i++) {
+						exits.push_back(emit(OpCode::Choice));
+						compileRule(child);
+						const int commit = emit(OpCode::Commit);
+						patch(commit, here());
+					}
+					// should the last try match, there were too many.
+					compileNot(child);
+					for (int exit : exits) {
+						patch(exit, here());
+					}
+				}
+
+				void compileChars(const vector<int>& values) {
+					if (values.size() == 1) {
+						emit(OpCode::Char, values.front());
+						return;
+					}
+					bitset<256> characters;
+					for (int value : values) {
+						if (value >= 0 && value < 256) {
+							characters.set(value);
+						}
+					}
+					emit(OpCode::Set, set(characters));
+				}
+
+				void compileRange(const vector<int>& values) {
+					bitset<256> characters;
+					for (int value = std::max(0, values.at(0)); value <= std::min(255, values.at(1)); value++) {
+						characters.set(value);
+					}
+					emit(OpCode::Set, set(characters));
+				}
+
+				/// <summary>
+				/// A set, unless there are code points to decode.
+				/// </summary>
+				void compileClass(const _sp<CharClassRule>& rule) {
+					if (!rule->hasCodePoints()) {
+						emit(OpCode::Set, set(rule->getBytes()));
+						return;
+					}
+					program->classes.push_back(rule);
+					emit(OpCode::Class, static_cast<int>(program->classes.size()) - 1);
+				}
+
+				/// <summary>
+				/// The longest of the strings that matches, one on its own compared in place, several as a trie.
+				/// </summary>
+				void compileStrings(const vector<string>& values) {
+					if (values.size() == 1) {
+						program->strings.push_back(values.front());
+						emit(OpCode::String, static_cast<int>(program->strings.size()) - 1);
+						return;
+					}
+					program->tries.push_back(make_shared<StringTrie>(values));
+					emit(OpCode::Strings, static_cast<int>(program->tries.size()) - 1);
+				}
+
+				_sp<RuleLibrary> library;
+				_sp<Program> program;
+				map<const Rule*, int> subroutines;
+				map<string, int> captureNames;
+				vector<pair<int, _sp<Rule>>> pending;
+			};
+
+			static _sp<Program> compile(_sp<RuleLibrary> library) {
+				return RuleCompiler(library).compile();
+			}
+
+			/// <summary>
+			/// Where a capture opened or closed, name is -1 for a close.
+			/// </summary>
+			struct Capture {
+				int name;
+				int position;
+			};
+
+			/// <summary>
+			/// Runs a program against the tokens.
+			/// Choices and calls share the one stack, a failure unwinds it to the last choice, and puts the position and captures back to how they were.
+			/// </summary>
+			class Machine {
+			public:
+				Machine(_sp<Program> program) : program(program), active(program->subroutines.size(), -1) {}
+
+				/// <summary>
+				/// Runs from entry, and returns where the match ended, or -1 if it failed.
+				/// Captures holds what was matched on the way.
+				/// </summary>
+				int run(const int entry, const Tokens& tokens, const int start) {
+					const Instruction* const code = program->code.data();
+					stack.clear();
+					captures.clear();
+					std::fill(active.begin(), active.end(), -1);
+					int pc = entry;
+					int position = start;
+					while (true) {
+						const Instruction& instruction = code[pc];
+						switch (instruction.code) {
+						case OpCode::Char: {
+							const int character = tokens->poll(position);
+							if (character != EOF && character == instruction.arg) {
+								position++;
+								pc++;
+								continue;
+							}
+							break;
+						}
+						case OpCode::Set: {
+							const int character = tokens->poll(position);
+							if (character != EOF && program->sets[instruction.arg].test(character)) {
+								position++;
+								pc++;
+								continue;
+							}
+							break;
+						}
+						case OpCode::Class: {
+							const int length = program->classes[instruction.arg]->matchAt(position, [&tokens](const int at) { return tokens->poll(at); });
+							if (length > 0) {
+								position += length;
+								pc++;
+								continue;
+							}
+							break;
+						}
+						case OpCode::Span:
+							position += program->spans[instruction.arg]->scan(tokens, position);
+							pc++;
+							continue;
+						case OpCode::String: {
+							const string& value = program->strings[instruction.arg];
+							if (!tokens->isEnd(position) && tokens->startsWith(position, value)) {
+								position += static_cast<int>(value.size());
+								pc++;
+								continue;
+							}
+							break;
+						}
+						case OpCode::Strings: {
+							const int length = tokens->isEnd(position) ? -1 : program->tries[instruction.arg]->longestAt(position, [&tokens](const int at) { return tokens->poll(at); });
+							if (length >= 0) {
+								position += length;
+								pc++;
+								continue;
+							}
+							break;
+						}
+						case OpCode::Any:
+							if (!tokens->isEnd(position)) {
+								position++;
+								pc++;
+								continue;
+							}
+							break;
+						case OpCode::End:
+							if (tokens->isEnd(position)) {
+								pc++;
+								continue;
+							}
+							break;
+						case OpCode::Choice:
+							stack.push_back(Frame{ instruction.arg, position, static_cast<int>(captures.size()), -1 });
+							pc++;
+							continue;
+						case OpCode::Commit:
+							stack.pop_back();
+							pc = instruction.arg;
+							continue;
+						case OpCode::PartialCommit: {
+							Frame& frame = stack.back();
+							if (frame.position == position) {
+								// matched nothing, so would go round forever.
+								stack.pop_back();
+								pc++;
+								continue;
+							}
+							frame.position = position;
+							frame.captures = static_cast<int>(captures.size());
+							pc = instruction.arg;
+							continue;
+						}
+						case OpCode::BackCommit: {
+							const Frame frame = stack.back();
+							stack.pop_back();
+							position = frame.position;
+							captures.resize(frame.captures);
+							pc = instruction.arg;
+							continue;
+						}
+						case OpCode::FailTwice:
+							stack.pop_back();
+							break;
+						case OpCode::Fail:
+							break;
+						case OpCode::Jump:
+							pc = instruction.arg;
+							continue;
+						case OpCode::Call: {
+							const int subroutine = instruction.arg;
+							// left recursion, the same as the history does it.
+							if (active[subroutine] == position) {
+								break;
+							}
+							stack.push_back(Frame{ pc + 1, active[subroutine], 0, subroutine });
+							active[subroutine] = position;
+							pc = program->subroutines[subroutine].start;
+							continue;
+						}
+						case OpCode::Return: {
+							const Frame frame = stack.back();
+							stack.pop_back();
+							active[frame.subroutine] = frame.position;
+							pc = frame.pc;
+							continue;
+						}
+						case OpCode::OpenCapture:
+							captures.push_back(Capture{ instruction.arg, position });
+							pc++;
+							continue;
+						case OpCode::CloseCapture:
+							captures.push_back(Capture{ -1, position });
+							pc++;
+							continue;
+						case OpCode::Halt:
+							return position;
+						}
+						// failed, unwind to the last choice.
+						while (true) {
+							if (stack.empty()) {
+								return -1;
+							}
+							const Frame frame = stack.back();
+							stack.pop_back();
+							if (frame.subroutine >= 0) {
+								active[frame.subroutine] = frame.position;
+								continue;
+							}
+							pc = frame.pc;
+							position = frame.position;
+							captures.resize(frame.captures);
+							break;
+						}
+					}
+				}
+
+				/// <summary>
+				/// Swaps the captures of the last run for into, so they can be kept without copying.
+				/// </summary>
+				void swapCaptures(vector<Capture>& into) {
+					captures.swap(into);
+				}
+
+				/// <summary>
+				/// The nodes for the given captures, the same as the evaluator makes.
+				/// </summary>
+				_sp_vec<SyntaxNode> buildNodes(const vector<Capture>& captures, const Tokens& tokens) {
+					struct Open {
+						int name;
+						int position;
+						_sp_vec<SyntaxNode> children;
+					};
+					vector<Open> open = { Open{ -1, 0, {} } };
+					for (const Capture& capture : captures) {
+						if (capture.name >= 0) {
+							open.push_back(Open{ capture.name, capture.position, {} });
+							continue;
+						}
+						Open closed = std::move(open.back());
+						open.pop_back();
+						open.back().children.push_back(make_shared<SyntaxNode>(program->captureNames[closed.name], tokens->pollRangeBetween(closed.position, capture.position), std::move(closed.children)));
+					}
+					return open.front().children;
+				}
+
+				/// <summary>
+				/// Adds the nodes for the given captures to tree, without making a SyntaxNode for any of them.
+				/// Captures open and close in the order a tree is built, so each one goes straight in.
+				/// </summary>
+				void buildTree(const vector<Capture>& captures, const Tokens& tokens, SyntaxTree& tree) {
+					if (!tree.getText()) {
+						tree.setText(tokens);
+					}
+					// the tree's type for each capture name, looked up the first time it is used.
+					vector<int> types(program->captureNames.size(), -1);
+					for (const Capture& capture : captures) {
+						if (capture.name >= 0) {
+							int& type = types[capture.name];
+							if (type < 0) {
+								type = tree.typeId(program->captureNames[capture.name]);
+							}
+							tree.open(type, tokens->isEnd(capture.position) ? SyntaxTree::NO_POSITION : capture.position);
+						}
+						else {
+							tree.close(capture.position);
+						}
+					}
+				}
+
+				_sp<Program> getProgram() {
+					return program;
+				}
+
+			protected:
+				/// <summary>
+				/// A choice, or a call when subroutine is set, in which case position is where the subroutine was last active.
+				/// </summary>
+				struct Frame {
+					int pc;
+					int position;
+					int captures;
+					int subroutine;
+				};
+
+				_sp<Program> program;
+				vector<Frame> stack;
+				vector<Capture> captures;
+				// the position each subroutine is being evaluated at, -1 if it isn't.
+				vector<int> active;
+			};
+
+			/// <summary>
+			/// Tries every symbol, and keeps the longest, the same as the EvaluationLibraryStrategy does.
+			/// </summary>
+			class MachineLibraryStrategy : public LibraryStrategy<Input, Output> {
+			public:
+				MachineLibraryStrategy(_sp<Program> program) : machine(program) {}
+
+				virtual Output accept(_sp<EvaluationVisitor>, _sp<RuleLibrary>, Input input) override {
+					const _sp<Program> program = machine.getProgram();
+					int longest = -1;
+					int chosen = -1;
+					for (size_t symbol = 0; symbol < program->symbolEntries.size(); symbol++) {
+						const int end = machine.run(program->symbolEntries[symbol], input.tokens, input.idx);
+						if (end > longest) {
+							longest = end;
+							chosen = static_cast<int>(symbol);
+							machine.swapCaptures(captures);
+						}
+					}
+					if (chosen < 0) {
+						return FAILURE;
+					}
+					_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(program->symbolNames[chosen], input.tokens->pollRangeBetween(input.idx, longest), machine.buildNodes(captures, input.tokens));
+					input.tokens->popRange(longest - input.idx);
+					return Output(longest, syntaxNode);
+				}
+
+			protected:
+				Machine machine;
+				// what the longest match so far captured.
+				vector<Capture> captures;
+			};
+
+			/// <summary>
+			/// Whether any rule of the library is an OPERATORS, which the machine can't nest.
+			/// </summary>
+			static bool hasOperators(const _sp<RuleLibrary>& library) {
+				bool found = false;
+				analysis::forEachRule(library, [&found](Rule& rule) {
+					found = found || rule.type == LogicRules::Operators;
+				});
+				return found;
+			}
+
+			/// <summary>
+			/// Strategies that evaluate the library with the machine, compiled once up front.
+			/// A library with operators in is walked by the evaluationStrategies() instead, which give the same nodes.
+			/// </summary>
+			static _sp<Strategies<Input, Output>> machineStrategies(_sp<RuleLibrary> library) {
+				if (hasOperators(library)) {
+					return evaluationStrategies();
+				}
+				auto strategies = make_shared<BaseStrategies<Input, Output>>();
+				strategies->setLibraryStrategy(make_shared<MachineLibraryStrategy>(compile(library)));
+				return strategies;
+			}
+		}
+	}
+}
+#endif
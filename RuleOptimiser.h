@@ -0,0 +1,696 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_RULE_OPTIMISER_H
+#define FLOCK_COMPILER_RULE_OPTIMISER_H
+
+#include "Util.h"
+#include "Rules.h"
+#include "LogicRules.h"
+#include "StringRules.h"
+#include "RuleAnalysis.h"
+#include "RuleHistory.h"
+#include <bitset>
+#include <map>
+#include <set>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+ ///
+ /// Rewrites a rule library into one that matches the same text, and makes the same syntax nodes, for less work.
+ ///
+namespace flock {
+	namespace rule {
+		using namespace std;
+		using namespace types;
+		namespace optimiser {
+			class RuleRewriter;
+
+			/// <summary>
+			/// One rewrite of the rules of a library.
+			/// </summary>
+			class RulePass {
+			public:
+				virtual ~RulePass() = default;
+				virtual string getName() const = 0;
+				/// <summary>
+				/// What to use in place of rule, whose children have already been through the pass, or rule as it is.
+				/// </summary>
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) = 0;
+			};
+
+			/// <summary>
+			/// Copies a library, a rule at a time, children first, handing each copy to a pass.
+			/// Rules shared in the library are shared in the copy. Aliases are always made anew, so the copy can be frozen on its own.
+			/// Only the rules this file knows the shape of can be copied, anything else under a unary or collection rule throws.
+			/// </summary>
+			class RuleRewriter {
+			public:
+				RuleRewriter(_sp<RuleLibrary> library, RulePass& pass) : library(library), pass(pass) {
+					for (const string& name : library->getSymbolNames()) {
+						productions.insert(library->getSymbol(name).get());
+					}
+					for (const string& name : library->getPartNames()) {
+						productions.insert(library->getPart(name).get());
+					}
+				}
+
+				/// <summary>
+				/// The new library, frozen if the old one was.
+				/// </summary>
+				_sp<RuleLibrary> run() {
+					_sp<RuleLibrary> rewrittenLibrary = make_shared<RuleLibrary>();
+					for (const string& name : library->getSymbolNames()) {
+						rewrittenLibrary->addSymbol(name, rewritten(library->getSymbol(name)));
+					}
+					for (const string& name : library->getPartNames()) {
+						rewrittenLibrary->addPart(name, rewritten(library->getPart(name)));
+					}
+					if (library->isFrozen()) {
+						rewrittenLibrary->freeze();
+					}
+					return rewrittenLibrary;
+				}
+
+				/// <summary>
+				/// The part an alias of name refers to, after the pass, or nullptr if it refers to a symbol, or to nothing.
+				/// Also nullptr while the part is still being rewritten, when it refers back to itself.
+				/// </summary>
+				_sp<Rule> rewrittenPart(const string& name) {
+					if (library->getSymbol(name)) {
+						return nullptr;
+					}
+					const _sp<Rule> part = library->getPart(name);
+					if (!part || inProgress.count(part.get()) > 0) {
+						return nullptr;
+					}
+					return rewritten(part);
+				}
+
+				const _sp<RuleLibrary>& getLibrary() {
+					return library;
+				}
+
+				/// <summary>
+				/// Whether the rule handed to the pass is the whole of a symbol or part, or the copy of one.
+				/// The memo policies pick what to remember by these, so a pass shouldn't merge one with another rule, or put one in place of a symbol or part.
+				/// </summary>
+				bool isProduction(const _sp<Rule>& rule) const {
+					return productions.count(rule.get()) > 0;
+				}
+
+			protected:
+				_sp<Rule> rewritten(const _sp<Rule>& rule) {
+					auto done = rewrites.find(rule.get());
+					if (done != rewrites.end()) {
+						return done->second;
+					}
+					inProgress.insert(rule.get());
+					const _sp<Rule> copied = copy(rule);
+					if (isProduction(rule)) {
+						productions.insert(copied.get());
+					}
+					const _sp<Rule> result = pass.rewrite(copied, *this);
+					inProgress.erase(rule.get());
+					rewrites.emplace(rule.get(), result);
+					return result;
+				}
+
+				/// <summary>
+				/// The rule with its children rewritten, the rule itself if none of them changed, bar aliases, which are always new.
+				/// </summary>
+				_sp<Rule> copy(const _sp<Rule>& rule) {
+					if (AliasRule* alias = dynamic_cast<AliasRule*>(rule.get())) {
+						return make_shared<AliasRule>(alias->getAlias());
+					}
+					if (UnaryRule* unary = dynamic_cast<UnaryRule*>(rule.get())) {
+						const _sp<Rule> child = rewritten(unary->getChild());
+						if (child == unary->getChild()) {
+							return rule;
+						}
+						if (typeid(*unary) == typeid(RepeatRule)) {
+							RepeatRule& repeat = static_cast<RepeatRule&>(*unary);
+							return make_shared<RepeatRule>(repeat.getMin(), repeat.getMax(), child);
+						}
+						if (typeid(*unary) == typeid(UnaryRule)) {
+							return make_shared<UnaryRule>(rule->type, child);
+						}
+					}
+					else if (CollectionRule* collection = dynamic_cast<CollectionRule*>(rule.get())) {
+						_sp_vec<Rule> children;
+						bool changed = false;
+						for (const _sp<Rule>& child : collection->getChildren()) {
+							children.push_back(rewritten(child));
+							changed = changed || children.back() != child;
+						}
+						if (!changed) {
+							return rule;
+						}
+						if (typeid(*collection) == typeid(CollectionRule)) {
+							return make_shared<CollectionRule>(rule->type, children);
+						}
+						if (typeid(*collection) == typeid(OperatorsRule)) {
+							vector<OperatorsRule::Operator> operators = static_cast<OperatorsRule&>(*collection).getOperators();
+							for (size_t i = 0; i < operators.size(); i++) {
+								operators[i].rule = children[i + 1];
+							}
+							return make_shared<OperatorsRule>(children.front(), operators);
+						}
+					}
+					else {
+						return rule;
+					}
+					throw string("Unable to optimise rule " + to_string(rule->id) + " of type " + to_string(rule->type) + ", there is no way to copy it");
+				}
+
+				_sp<RuleLibrary> library;
+				RulePass& pass;
+				// old rule to new.
+				map<Rule*, _sp<Rule>> rewrites;
+				std::set<Rule*> inProgress;
+				// the symbols and parts, and their copies.
+				std::set<Rule*> productions;
+			};
+
+			/// <summary>
+			/// Collapses the ors, buts and multi character equals made only of single characters, and the aliases to parts that are nothing more, into one CharClassRule each.
+			/// One lookup then stands in for a visit to every rule in the tree.
+			/// </summary>
+			class CharClassPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "character classes";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) override {
+					switch (rule->type) {
+					case StringRules::EqualChar:
+						if (static_cast<ValuesRule<int>&>(*rule).getValues().size() > 1) {
+							return asClass(rule, rewriter);
+						}
+						return rule;
+					case LogicRules::Or:
+						for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+							if (!isClass(child, rewriter)) {
+								return rule;
+							}
+						}
+						return asClass(rule, rewriter);
+					case LogicRules::AnyBut:
+						if (isClass(static_cast<UnaryRule&>(*rule).getChild(), rewriter)) {
+							return asClass(rule, rewriter);
+						}
+						return rule;
+					case LogicRules::Alias:
+						if (isClass(rule, rewriter)) {
+							return asClass(rule, rewriter);
+						}
+						return rule;
+					default:
+						return rule;
+					}
+				}
+
+			protected:
+				/// <summary>
+				/// Whether the rule only ever matches a single character, other than a lone character or range, which are as quick as a class.
+				/// </summary>
+				bool isClass(const _sp<Rule>& rule, RuleRewriter& rewriter) {
+					bitset<256> bytes;
+					vector<pair<int, int>> codePoints;
+					return collect(rule, rewriter, bytes, codePoints);
+				}
+
+				_sp<Rule> asClass(const _sp<Rule>& rule, RuleRewriter& rewriter) {
+					bitset<256> bytes;
+					vector<pair<int, int>> codePoints;
+					if (!collect(rule, rewriter, bytes, codePoints)) {
+						return rule;
+					}
+					if (rule->type == StringRules::CharClass) {
+						return rule;
+					}
+					return make_shared<CharClassRule>(bytes, codePoints);
+				}
+
+				bool collect(const _sp<Rule>& rule, RuleRewriter& rewriter, bitset<256>& bytes, vector<pair<int, int>>& codePoints) {
+					// only parts, symbols make syntax nodes.
+					return analysis::collectCharacters(rule, [&rewriter](const string& name) { return rewriter.rewrittenPart(name); }, bytes, codePoints);
+				}
+			};
+
+			/// <summary>
+			/// Puts the part an alias names in place of the alias, where the part is a single terminal, or the alias is the only use of it.
+			/// The part is still in the library, and the rule put in place is the same one, so it is remembered as it was. Symbols make nodes, so are left as they are.
+			/// </summary>
+			class InlinePartsPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "inline parts";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) override {
+					if (rule->type != LogicRules::Alias || rewriter.isProduction(rule)) {
+						return rule;
+					}
+					if (counted != rewriter.getLibrary()) {
+						countUses(rewriter.getLibrary());
+					}
+					const string& name = static_cast<AliasRule&>(*rule).getAlias();
+					const _sp<Rule> part = rewriter.rewrittenPart(name);
+					if (!part || (!isTrivial(*part) && uses[name] > 1)) {
+						return rule;
+					}
+					return part;
+				}
+
+			protected:
+				static bool isTrivial(const Rule& rule) {
+					switch (rule.type) {
+					case StringRules::EqualChar:
+					case StringRules::EqualString:
+					case StringRules::CharRange:
+					case StringRules::CharClass:
+					case LogicRules::Any:
+					case LogicRules::End:
+					case LogicRules::Alias:
+						return true;
+					default:
+						return false;
+					}
+				}
+
+				/// <summary>
+				/// How many places each name is aliased from, a rule shared between several only counting once, as it is only rewritten once.
+				/// </summary>
+				void countUses(const _sp<RuleLibrary>& library) {
+					counted = library;
+					uses.clear();
+					const auto use = [this](const _sp<Rule>& rule) {
+						if (rule && rule->type == LogicRules::Alias) {
+							uses[static_cast<AliasRule&>(*rule).getAlias()]++;
+						}
+					};
+					for (const string& name : library->getSymbolNames()) {
+						use(library->getSymbol(name));
+					}
+					for (const string& name : library->getPartNames()) {
+						use(library->getPart(name));
+					}
+					analysis::forEachRule(library, [&use](Rule& rule) {
+						if (UnaryRule* unary = dynamic_cast<UnaryRule*>(&rule)) {
+							use(unary->getChild());
+						}
+						else if (CollectionRule* collection = dynamic_cast<CollectionRule*>(&rule)) {
+							for (const _sp<Rule>& child : collection->getChildren()) {
+								use(child);
+							}
+						}
+					});
+				}
+
+				_sp<RuleLibrary> counted;
+				map<string, int> uses;
+			};
+
+			/// <summary>
+			/// Lifts the children of a sequence in a sequence, or an or in an or, into the one above, and puts the child of a sequence or or of one in its place.
+			/// </summary>
+			class FlattenPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "flatten";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) override {
+					if ((rule->type != LogicRules::Sequence && rule->type != LogicRules::Or) || typeid(*rule) != typeid(CollectionRule)) {
+						return rule;
+					}
+					_sp_vec<Rule> children;
+					bool changed = false;
+					for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+						// children come first, so theirs are already as flat as they get.
+						if (child->type == rule->type && typeid(*child) == typeid(CollectionRule)) {
+							const _sp_vec<Rule>& grandchildren = static_cast<CollectionRule&>(*child).getChildren();
+							children.insert(children.end(), grandchildren.begin(), grandchildren.end());
+							changed = true;
+						}
+						else {
+							children.push_back(child);
+						}
+					}
+					if (children.size() == 1 && !rewriter.isProduction(rule)) {
+						return children.front();
+					}
+					if (!changed) {
+						return rule;
+					}
+					return make_shared<CollectionRule>(rule->type, children);
+				}
+			};
+
+			/// <summary>
+			/// Joins the characters and strings next to each other in a sequence into one string, compared in place in one go.
+			/// A string fails where the source stops following it, so the farthest failure is where the characters would have put it.
+			/// </summary>
+			class FuseLiteralsPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "fuse literals";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter&) override {
+					if (rule->type != LogicRules::Sequence || typeid(*rule) != typeid(CollectionRule)) {
+						return rule;
+					}
+					_sp_vec<Rule> children;
+					bool changed = false;
+					// the literals since the last child that isn't one.
+					_sp_vec<Rule> run;
+					string joined;
+					const auto endRun = [&]() {
+						if (run.size() > 1) {
+							children.push_back(EQ(joined));
+							changed = true;
+						}
+						else {
+							children.insert(children.end(), run.begin(), run.end());
+						}
+						run.clear();
+						joined.clear();
+					};
+					for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+						string literal;
+						if (literalOf(*child, literal)) {
+							run.push_back(child);
+							joined += literal;
+						}
+						else {
+							endRun();
+							children.push_back(child);
+						}
+					}
+					endRun();
+					if (!changed) {
+						return rule;
+					}
+					// if it was all one string, that is new, so can stand in for a symbol or part.
+					if (children.size() == 1) {
+						return children.front();
+					}
+					return make_shared<CollectionRule>(LogicRules::Sequence, children);
+				}
+
+			protected:
+				/// <summary>
+				/// The text of a rule that only ever matches one thing, a single character or a single non empty string.
+				/// </summary>
+				static bool literalOf(Rule& rule, string& literal) {
+					if (rule.type == StringRules::EqualChar) {
+						const vector<int>& values = static_cast<ValuesRule<int>&>(rule).getValues();
+						if (values.size() == 1 && values.front() >= 0 && values.front() < 256) {
+							literal = string(1, static_cast<char>(values.front()));
+							return true;
+						}
+					}
+					else if (rule.type == StringRules::EqualString) {
+						const vector<string>& values = static_cast<ValuesRule<string>&>(rule).getValues();
+						if (values.size() == 1 && !values.front().empty()) {
+							literal = values.front();
+							return true;
+						}
+					}
+					return false;
+				}
+			};
+
+			/// <summary>
+			/// A key for what a rule is, its type, values and the ids of its children, false for a rule of a type this doesn't know.
+			/// Two rules with the same key match the same, as long as their children are the same objects.
+			/// </summary>
+			static bool shapeOf(const _sp<Rule>& rule, string& key) {
+				const type_info& type = typeid(*rule);
+				key = to_string(rule->type) + ":";
+				if (type == typeid(TerminalRule)) {
+					key += "terminal";
+				}
+				else if (type == typeid(ValuesRule<int>)) {
+					key += "chars";
+					for (const int value : static_cast<ValuesRule<int>&>(*rule).getValues()) {
+						key += " " + to_string(value);
+					}
+				}
+				else if (type == typeid(ValuesRule<string>)) {
+					key += "strings";
+					for (const string& value : static_cast<ValuesRule<string>&>(*rule).getValues()) {
+						key += " " + to_string(value.size()) + ":" + value;
+					}
+				}
+				else if (type == typeid(CharClassRule)) {
+					CharClassRule& chars = static_cast<CharClassRule&>(*rule);
+					key += "class " + chars.getBytes().to_string();
+					for (const pair<int, int>& range : chars.getCodePoints()) {
+						key += " " + to_string(range.first) + "-" + to_string(range.second);
+					}
+				}
+				else if (type == typeid(AliasRule)) {
+					key += "alias " + static_cast<AliasRule&>(*rule).getAlias();
+				}
+				else if (type == typeid(RepeatRule)) {
+					RepeatRule& repeat = static_cast<RepeatRule&>(*rule);
+					key += "repeat " + to_string(repeat.getMin()) + " " + to_string(repeat.getMax()) + " " + to_string(repeat.getChild()->id);
+				}
+				else if (type == typeid(UnaryRule)) {
+					key += "unary " + to_string(static_cast<UnaryRule&>(*rule).getChild()->id);
+				}
+				else if (type == typeid(CollectionRule)) {
+					key += "collection";
+					for (const _sp<Rule>& child : static_cast<CollectionRule&>(*rule).getChildren()) {
+						key += " " + to_string(child->id);
+					}
+				}
+				else if (type == typeid(OperatorsRule)) {
+					OperatorsRule& operators = static_cast<OperatorsRule&>(*rule);
+					key += "operators " + to_string(operators.getOperand()->id);
+					for (const OperatorsRule::Operator& op : operators.getOperators()) {
+						key += " " + to_string(op.name.size()) + ":" + op.name + " " + to_string(op.precedence) + (op.associativity == Associativity::Left ? " left " : " right ") + to_string(op.rule->id);
+					}
+				}
+				else {
+					return false;
+				}
+				return true;
+			}
+
+			/// <summary>
+			/// Makes the rules that are the same, type, values and children, one rule, so they are visited, remembered and compiled once.
+			/// Children come first, so two rules are the same if their children are the same objects.
+			/// Symbols and parts are kept apart, the memo policies pick what to remember by them, and rules of a type this doesn't know are left alone.
+			/// </summary>
+			class HashConsPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "hash cons";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) override {
+					if (rewriter.isProduction(rule)) {
+						return rule;
+					}
+					if (seen != rewriter.getLibrary()) {
+						seen = rewriter.getLibrary();
+						rules.clear();
+					}
+					string key;
+					if (!shapeOf(rule, key)) {
+						return rule;
+					}
+					return rules.emplace(key, rule).first->second;
+				}
+
+			protected:
+				_sp<RuleLibrary> seen;
+				// the first of each shape, by its key.
+				map<string, _sp<Rule>> rules;
+			};
+
+			/// <summary>
+			/// Matches what the alternatives of an or, next to each other, start with in common once, and then the or of what is left of them.
+			/// An or tries its alternatives in order, and a rule only ever matches one way where it is, so the alternatives that start with P, A and P, B
+			/// match the same as P then A or B. An alternative that is all of P is P then optionally the rest, and any after it could never be reached.
+			/// Only what is written in the or is compared, aliases are not looked into. Symbols make nodes, and parts are remembered,
+			/// so starting two alternatives with the same part already costs no more than a lookup, which is less than matching what is in it.
+			/// What it makes is flattened, so the sequences it starts sit in the ones around them.
+			/// </summary>
+			class LeftFactorPass : public RulePass {
+			public:
+				virtual string getName() const override {
+					return "left factor";
+				}
+
+				virtual _sp<Rule> rewrite(const _sp<Rule>& rule, RuleRewriter& rewriter) override {
+					if (rule->type != LogicRules::Or || typeid(*rule) != typeid(CollectionRule)) {
+						return flatten.rewrite(rule, rewriter);
+					}
+					const _sp<Rule> factored = factor(static_cast<CollectionRule&>(*rule).getChildren());
+					return factored ? flatten.rewrite(factored, rewriter) : rule;
+				}
+
+			protected:
+				/// <summary>
+				/// The or of the alternatives with the runs that start the same factored, or nullptr if none do.
+				/// </summary>
+				static _sp<Rule> factor(const _sp_vec<Rule>& alternatives) {
+					vector<_sp_vec<Rule>> sequences;
+					for (const _sp<Rule>& alternative : alternatives) {
+						sequences.push_back(sequenceOf(alternative));
+					}
+					_sp_vec<Rule> factored;
+					bool changed = false;
+					for (size_t first = 0; first < alternatives.size();) {
+						size_t last = first + 1;
+						while (last < alternatives.size() && same(sequences[first].front(), sequences[last].front())) {
+							last++;
+						}
+						if (last - first == 1) {
+							factored.push_back(alternatives[first]);
+							first = last;
+							continue;
+						}
+						size_t length = 1;
+						while (sharedAt(sequences, first, last, length)) {
+							length++;
+						}
+						_sp_vec<Rule> prefixed(sequences[first].begin(), sequences[first].begin() + length);
+						_sp_vec<Rule> rests;
+						bool optional = false;
+						for (size_t i = first; i < last && !optional; i++) {
+							const _sp_vec<Rule>& sequence = sequences[i];
+							if (sequence.size() == length) {
+								optional = true;
+							}
+							else if (sequence.size() == length + 1) {
+								rests.push_back(sequence.back());
+							}
+							else {
+								rests.push_back(make_shared<CollectionRule>(LogicRules::Sequence, _sp_vec<Rule>(sequence.begin() + length, sequence.end())));
+							}
+						}
+						if (!rests.empty()) {
+							_sp<Rule> rest = rests.size() == 1 ? rests.front() : factor(rests);
+							if (!rest) {
+								rest = make_shared<CollectionRule>(LogicRules::Or, rests);
+							}
+							prefixed.push_back(optional ? OPT(rest) : rest);
+						}
+						factored.push_back(prefixed.size() == 1 ? prefixed.front() : make_shared<CollectionRule>(LogicRules::Sequence, prefixed));
+						changed = true;
+						first = last;
+					}
+					if (!changed) {
+						return nullptr;
+					}
+					return factored.size() == 1 ? factored.front() : make_shared<CollectionRule>(LogicRules::Or, factored);
+				}
+
+				/// <summary>
+				/// Whether all of the sequences from first to last have the same rule at index.
+				/// </summary>
+				static bool sharedAt(const vector<_sp_vec<Rule>>& sequences, const size_t first, const size_t last, const size_t index) {
+					for (size_t i = first; i < last; i++) {
+						if (sequences[i].size() <= index || !same(sequences[first][index], sequences[i][index])) {
+							return false;
+						}
+					}
+					return true;
+				}
+
+				/// <summary>
+				/// The children of a sequence, anything else on its own.
+				/// </summary>
+				static _sp_vec<Rule> sequenceOf(const _sp<Rule>& rule) {
+					if (rule->type == LogicRules::Sequence && typeid(*rule) == typeid(CollectionRule)) {
+						return static_cast<CollectionRule&>(*rule).getChildren();
+					}
+					return { rule };
+				}
+
+				/// <summary>
+				/// The same rule, or one made the same way from the same children, as the hash cons pass leaves them.
+				/// </summary>
+				static bool same(const _sp<Rule>& rule, const _sp<Rule>& other) {
+					if (rule == other) {
+						return true;
+					}
+					string ruleShape;
+					string otherShape;
+					return shapeOf(rule, ruleShape) && shapeOf(other, otherShape) && ruleShape == otherShape;
+				}
+
+				FlattenPass flatten;
+			};
+
+			/// <summary>
+			/// How many rules a pass left the library with.
+			/// </summary>
+			struct PassReport {
+				string name;
+				size_t rulesBefore;
+				size_t rulesAfter;
+			};
+
+			/// <summary>
+			/// The library, run through each of the passes in turn, and if asked, how many rules there were before and after each.
+			/// </summary>
+			static _sp<RuleLibrary> optimise(_sp<RuleLibrary> library, const vector<_sp<RulePass>>& passes, vector<PassReport>* report = nullptr) {
+				for (const _sp<RulePass>& pass : passes) {
+					const size_t before = report ? analysis::countRules(library) : 0;
+					library = RuleRewriter(library, *pass).run();
+					if (report) {
+						report->push_back({ pass->getName(), before, analysis::countRules(library) });
+					}
+				}
+				return library;
+			}
+
+			/// <summary>
+			/// The passes optimise uses unless told otherwise.
+			/// Classes first, so a part that is one can be inlined, literals are fused once the sequences around them are flat,
+			/// and ors are factored once what their alternatives start with has been made the same rule.
+			/// </summary>
+			static vector<_sp<RulePass>> defaultPasses() {
+				return { make_shared<CharClassPass>(), make_shared<InlinePartsPass>(), make_shared<FlattenPass>(), make_shared<FuseLiteralsPass>(), make_shared<HashConsPass>(), make_shared<LeftFactorPass>() };
+			}
+
+			static _sp<RuleLibrary> optimise(_sp<RuleLibrary> library, vector<PassReport>* report = nullptr) {
+				return optimise(library, defaultPasses(), report);
+			}
+
+			/// <summary>
+			/// The default passes, bar those that change which rules there are to remember, when the policy remembers rules it wasn't told are productions.
+			/// Remembering every rule, hash consing would have rules that were apart share an id, so a left recursion running one would fail the other.
+			/// Picking rules by name, they should be the rules as they were written, so parts aren't inlined either.
+			/// </summary>
+			static vector<_sp<RulePass>> passesFor(const history::MemoMode mode) {
+				if (mode != history::MemoMode::All && mode != history::MemoMode::Selected) {
+					return defaultPasses();
+				}
+				return { make_shared<CharClassPass>(), make_shared<FlattenPass>(), make_shared<FuseLiteralsPass>(), make_shared<LeftFactorPass>() };
+			}
+		}
+	}
+}
+#endif
@@ -60,6 +60,9 @@ namespace flock {
 			template<typename IN, typename OUT>
 			using WrappingRuleStrategy = visitor::WrappingStrategy<IN, OUT, Rule, RuleVisitor<IN, OUT>>;
 
+			template<typename IN, typename OUT, typename TYPED, typename DERIVED>
+			using TypedRuleStrategy = visitor::TypedStrategy<IN, OUT, Rule, RuleVisitor<IN, OUT>, TYPED, DERIVED>;
+
 			template<typename IN, typename OUT>
 			using WrappingLibraryStrategy = visitor::WrappingLibraryStrategy<IN, OUT, Rule, RuleVisitor<IN, OUT>, LibraryStrategy<IN, OUT>>;
 
@@ -90,6 +93,9 @@ namespace flock {
 			public:
 				RuleLibrary(_sp<LibraryAddStrategy> addStrategy) : addStrategy(addStrategy) {}
 				RuleLibrary() : RuleLibrary(make_shared<LibraryAddStrategy>()) {}
+				~RuleLibrary() {
+					unfreeze();
+				}
 
 				_sp <Rule> addSymbol(const string symbolName, _sp<Rule> expression) {
 					return addSymbol(symbolName, addStrategy, expression);
@@ -98,12 +104,28 @@ namespace flock {
 					return addPart(partName, addStrategy, expression);
 				}
 				_sp <Rule> addSymbol(const string symbolName, _sp< LibraryAddStrategy> addStrategy, _sp<Rule> expression) {
+					checkNotFrozen(symbolName);
 					return addStrategy->addNode(this->shared_from_this(), symbolName, expression);
 				}
 				_sp <Rule> addPart(const string partName, _sp< LibraryAddStrategy> addStrategy, _sp<Rule> expression) {
+					checkNotFrozen(partName);
 					return addStrategy->addNode(parts, partName, expression);
 				}
 
+				/// <summary>
+				/// Checks every alias in the library names a symbol or a part, throwing with the ones that don't,
+				/// and binds each to the rule it names, so visiting one no longer looks it up by name.
+				/// Nothing can be added once frozen. Defined alongside AliasRule.
+				/// </summary>
+				void freeze();
+				/// <summary>
+				/// Lets go of the aliases bound by freeze, so the library can be added to again.
+				/// </summary>
+				void unfreeze();
+				bool isFrozen() {
+					return frozen;
+				}
+
 				_sp<Rule> getSymbol(const string symbolName) {
 					return getNode(symbolName);
 				}
@@ -117,9 +139,18 @@ namespace flock {
 					return parts->getNames();
 				}
 			protected:
+				void checkNotFrozen(const string& name) {
+					if (frozen) {
+						throw string("Unable to add " + name + ", the library is frozen");
+					}
+				}
+
 				// parts are usefull rules, but we are not interested in collecting information on them.
 				_sp<visitor::Library<Rule>> parts = make_shared<visitor::Library<Rule>>();
 				_sp<LibraryAddStrategy> addStrategy;
+				bool frozen = false;
+				// the aliases freeze bound.
+				vector<Rule*> bound;
 			};
 
 			/// <summary>
@@ -131,11 +162,11 @@ namespace flock {
 			class BaseMixinsCombined {
 			public:
 				virtual ~BaseMixinsCombined() = default;
-				virtual bool isFailure(OUT out) = 0;
+				virtual bool isFailure(const OUT& out) = 0;
 				virtual OUT makeFailure() = 0;
-				virtual OUT makeSuccess(IN input) = 0;
-				virtual OUT makeEmptySuccess(IN input) = 0;
-				virtual bool isEnd(IN input) = 0;
+				virtual OUT makeSuccess(const IN& input) = 0;
+				virtual OUT makeEmptySuccess(const IN& input) = 0;
+				virtual bool isEnd(const IN& input) = 0;
 			};
 
 			template<typename IN, typename OUT, typename MIX = BaseMixinsCombined<IN, OUT>>
@@ -146,6 +177,17 @@ namespace flock {
 				const _sp<MIX> mixins; //ish
 			};
 
+			/// <summary>
+			/// A MixinsRuleStrategy that is handed its rule already cast, see visitor::TypedStrategy.
+			/// </summary>
+			template<typename IN, typename OUT, typename TYPED, typename DERIVED, typename MIX = BaseMixinsCombined<IN, OUT>>
+			class TypedMixinsRuleStrategy : public TypedRuleStrategy<IN, OUT, TYPED, DERIVED> {
+			public:
+				TypedMixinsRuleStrategy(const _sp<MIX> mixins) : mixins(mixins) {}
+			protected:
+				const _sp<MIX> mixins;
+			};
+
 			/// <summary>
 			/// The sole job of the visitor is to glue the aenimic rules to the strategys, whose job it is to navigate the visitor up and doen the tree.
 			/// </summary>
@@ -167,13 +209,13 @@ namespace flock {
 					}
 				}
 
-				virtual OUT visitPart(const string name, const _sp<Rule> rule, const IN input) {
+				virtual OUT visitPart(const string& name, const _sp<Rule>& rule, const IN& input) {
 					if (rule) {
 						return this->visit(rule, input);
 					}
 					throw string("Rule Part " + name + " does not exist");
 				}
-				virtual OUT visitSymbol(const string name, const _sp<Rule> rule, const IN input) {
+				virtual OUT visitSymbol(const string& name, const _sp<Rule>& rule, const IN& input) {
 					if (rule) {
 						return this->visit(rule, input);
 					}
@@ -181,11 +223,11 @@ namespace flock {
 				}
 
 				virtual _sp<Rule> getPart(const string partName) {
-					return library->getPart(partName);
+					return this->library->getPart(partName);
 				}
 
 				virtual _sp<Rule> getSymbol(const string symbolName) {
-					return library->getSymbol(symbolName);
+					return this->library->getSymbol(symbolName);
 				}
 			protected:
 			};
@@ -200,7 +242,7 @@ namespace flock {
 				UnaryRule(const int type, _sp<Rule> child) : Rule(type), child(child) {
 					assert(child); // no nullptrs
 				};
-				_sp<Rule> getChild() {
+				const _sp<Rule>& getChild() {
 					return child;
 				}
 			protected:
@@ -225,7 +267,7 @@ namespace flock {
 				}
 				CollectionRule(const int type, initializer_list<_sp<Rule>> children) : CollectionRule(type, _sp_vec<Rule>(children)) {}
 
-				_sp_vec<Rule> getChildren() {
+				const _sp_vec<Rule>& getChildren() {
 					return children;
 				}
 			protected:
@@ -238,7 +280,7 @@ namespace flock {
 				ValuesRule(const int type, vector<T> values) : TerminalRule(type), values(values) {}
 				ValuesRule(const int type, initializer_list<T> values) : ValuesRule(type, vector<T>(values)) {}
 
-				vector<T> getValues() {
+				const vector<T>& getValues() {
 					return values;
 				}
 			protected:
@@ -246,18 +288,15 @@ namespace flock {
 			};
 
 			template<typename T, typename IN, typename OUT>
-			class HasValueRuleStrategy : public MixinsRuleStrategy<IN, OUT> {
+			class HasValueRuleStrategy : public TypedMixinsRuleStrategy<IN, OUT, ValuesRule<T>, HasValueRuleStrategy<T, IN, OUT>> {
 			public:
-				HasValueRuleStrategy(_sp<BaseMixinsCombined<IN, OUT>> mixins) : MixinsRuleStrategy<IN, OUT>(mixins) {}
+				HasValueRuleStrategy(_sp<BaseMixinsCombined<IN, OUT>> mixins) : TypedMixinsRuleStrategy<IN, OUT, ValuesRule<T>, HasValueRuleStrategy<T, IN, OUT>>(mixins) {}
 
-				virtual OUT accept(const _sp<RuleVisitor<IN, OUT>> visitor, const _sp<Rule> baseRule, const IN input) override {
+				OUT acceptTyped(const _sp<RuleVisitor<IN, OUT>>&, ValuesRule<T>& rule, const IN& input) {
 					if (this->mixins->isEnd(input)) {
 						return this->mixins->makeFailure();
 					}
-					const auto rule = std::dynamic_pointer_cast<ValuesRule<T>>(baseRule);
-					vector<T> values = rule->getValues();
-
-					for (T value : values) {
+					for (const T& value : rule.getValues()) {
 						OUT match = matches(value, input);
 						if (!this->mixins->isFailure(match)) {
 							return match;
@@ -266,7 +305,7 @@ namespace flock {
 					return this->mixins->makeFailure(); // return failure.
 				}
 
-				virtual OUT matches(T value, IN input) = 0;
+				virtual OUT matches(const T& value, IN input) = 0;
 			};
 
 			static _sp<CollectionRule> _collectionRule(const int type, _sp_vec<Rule> rules) {
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_SIMD_SCAN_H
+#define FLOCK_COMPILER_SIMD_SCAN_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#define FLOCK_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOCK_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+ ///
+ /// Byte scanning kernels, vectorised where the target allows it, with a scalar fallback that gives the same answers.
+ ///
+namespace flock {
+	namespace simd {
+
+		static inline int countTrailingZeros(uint32_t bits) {
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, bits);
+			return static_cast<int>(index);
+#else
+			return __builtin_ctz(bits);
+#endif
+		}
+
+		/// <summary>
+		/// Calls found(offset) for every '\n' and '\r' in the given bytes, in order.
+		/// Both count as line breaks, the same as isNewLine.
+		/// </summary>
+		template<typename FOUND>
+		static void forEachNewLine(const char* data, const size_t length, FOUND found) {
+			size_t offset = 0;
+#ifdef FLOCK_SIMD_SSE2
+			const __m128i lineFeed = _mm_set1_epi8('\n');
+			const __m128i carriageReturn = _mm_set1_epi8('\r');
+			for (; offset + 16 <= length; offset += 16) {
+				const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+				uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lineFeed), _mm_cmpeq_epi8(block, carriageReturn))));
+				while (mask) {
+					found(offset + countTrailingZeros(mask));
+					mask &= mask - 1;
+				}
+			}
+#endif
+			for (; offset < length; offset++) {
+				if (data[offset] == '\n' || data[offset] == '\r') {
+					found(offset);
+				}
+			}
+		}
+
+		/// <summary>
+		/// A set of bytes, as a table for the scalar loop, and as the runs of consecutive bytes in it for the vector ones.
+		/// Each run costs a compare per block, so past MAX_RANGES of them the table is quicker, and is all that is used.
+		/// </summary>
+		class ByteSet {
+		public:
+			static constexpr size_t MAX_RANGES = 8;
+
+			explicit ByteSet(const std::bitset<256>& bytes) {
+				for (int value = 0; value < 256; value++) {
+					table[value] = bytes.test(value);
+					if (!table[value]) {
+						continue;
+					}
+					if (value > 0 && table[value - 1]) {
+						ranges.back().second = static_cast<uint8_t>(value);
+					}
+					else {
+						ranges.emplace_back(static_cast<uint8_t>(value), static_cast<uint8_t>(value));
+					}
+				}
+			}
+
+			bool contains(const char byte) const {
+				return table[static_cast<unsigned char>(byte)];
+			}
+
+			/// <summary>
+			/// Inclusive, in order.
+			/// </summary>
+			const std::vector<std::pair<uint8_t, uint8_t>>& getRanges() const {
+				return ranges;
+			}
+
+			bool isVectorised() const {
+				return ranges.size() <= MAX_RANGES;
+			}
+
+		protected:
+			bool table[256];
+			std::vector<std::pair<uint8_t, uint8_t>> ranges;
+		};
+
+		/// <summary>
+		/// How many of the given bytes, from the first, are in the set.
+		/// A byte is in a run when, less the start of the run, it is no more than its width, unsigned, so each run is a subtract, a min and a compare.
+		/// </summary>
+		static size_t spanOf(const ByteSet& set, const char* data, const size_t length) {
+			size_t offset = 0;
+#if defined(FLOCK_SIMD_AVX2) || defined(FLOCK_SIMD_SSE2)
+			if (set.isVectorised()) {
+				const auto& ranges = set.getRanges();
+				const size_t count = ranges.size();
+#ifdef FLOCK_SIMD_AVX2
+				__m256i wideStarts[ByteSet::MAX_RANGES];
+				__m256i wideWidths[ByteSet::MAX_RANGES];
+				for (size_t r = 0; r < count; r++) {
+					wideStarts[r] = _mm256_set1_epi8(static_cast<char>(ranges[r].first));
+					wideWidths[r] = _mm256_set1_epi8(static_cast<char>(ranges[r].second - ranges[r].first));
+				}
+				for (; offset + 32 <= length; offset += 32) {
+					const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+					__m256i in = _mm256_setzero_si256();
+					for (size_t r = 0; r < count; r++) {
+						const __m256i shifted = _mm256_sub_epi8(block, wideStarts[r]);
+						in = _mm256_or_si256(in, _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, wideWidths[r]), shifted));
+					}
+					const uint32_t outside = ~static_cast<uint32_t>(_mm256_movemask_epi8(in));
+					if (outside) {
+						return offset + countTrailingZeros(outside);
+					}
+				}
+#endif
+#ifdef FLOCK_SIMD_SSE2
+				__m128i starts[ByteSet::MAX_RANGES];
+				__m128i widths[ByteSet::MAX_RANGES];
+				for (size_t r = 0; r < count; r++) {
+					starts[r] = _mm_set1_epi8(static_cast<char>(ranges[r].first));
+					widths[r] = _mm_set1_epi8(static_cast<char>(ranges[r].second - ranges[r].first));
+				}
+				for (; offset + 16 <= length; offset += 16) {
+					const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+					__m128i in = _mm_setzero_si128();
+					for (size_t r = 0; r < count; r++) {
+						const __m128i shifted = _mm_sub_epi8(block, starts[r]);
+						in = _mm_or_si128(in, _mm_cmpeq_epi8(_mm_min_epu8(shifted, widths[r]), shifted));
+					}
+					const uint32_t outside = ~static_cast<uint32_t>(_mm_movemask_epi8(in)) & 0xFFFF;
+					if (outside) {
+						return offset + countTrailingZeros(outside);
+					}
+				}
+#endif
+			}
+#endif
+			for (; offset < length; offset++) {
+				if (!set.contains(data[offset])) {
+					break;
+				}
+			}
+			return offset;
+		}
+
+		/// <summary>
+		/// Strings to search for, found by looking for a byte one of them could start with, and checking each string there.
+		/// With a single string of two bytes or more, its last byte has to be in place too, which rules out most of what the first would let through.
+		/// </summary>
+		class LiteralSet {
+		public:
+			explicit LiteralSet(const std::vector<std::string>& literals) : literals(literals), others(startingBytes(literals, empty).flip()) {
+				if (literals.size() == 1 && literals.front().size() >= 2) {
+					paired = true;
+					first = literals.front().front();
+					last = literals.front().back();
+					distance = literals.front().size() - 1;
+				}
+			}
+
+			const std::vector<std::string>& getLiterals() const {
+				return literals;
+			}
+
+			/// <summary>
+			/// Whether one of them is empty, and so found everywhere.
+			/// </summary>
+			bool hasEmpty() const {
+				return empty;
+			}
+
+			/// <summary>
+			/// The first offset one of the literals could start at, length if there is none.
+			/// Where a literal would run past the end of the bytes only its first byte is checked, the rest is for whoever has the bytes after.
+			/// </summary>
+			size_t findCandidate(const char* data, const size_t length) const {
+				if (!paired) {
+					return spanOf(others, data, length);
+				}
+				size_t offset = 0;
+#ifdef FLOCK_SIMD_AVX2
+				const __m256i wideFirst = _mm256_set1_epi8(first);
+				const __m256i wideLast = _mm256_set1_epi8(last);
+				for (; offset + distance + 32 <= length; offset += 32) {
+					const __m256i starts = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)), wideFirst);
+					const __m256i ends = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + distance)), wideLast);
+					const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(starts, ends)));
+					if (mask) {
+						return offset + countTrailingZeros(mask);
+					}
+				}
+#endif
+#ifdef FLOCK_SIMD_SSE2
+				const __m128i narrowFirst = _mm_set1_epi8(first);
+				const __m128i narrowLast = _mm_set1_epi8(last);
+				for (; offset + distance + 16 <= length; offset += 16) {
+					const __m128i starts = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), narrowFirst);
+					const __m128i ends = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + distance)), narrowLast);
+					const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(starts, ends)));
+					if (mask) {
+						return offset + countTrailingZeros(mask);
+					}
+				}
+#endif
+				for (; offset < length; offset++) {
+					if (data[offset] == first && (offset + distance >= length || data[offset + distance] == last)) {
+						return offset;
+					}
+				}
+				return length;
+			}
+
+		protected:
+			static std::bitset<256> startingBytes(const std::vector<std::string>& literals, bool& empty) {
+				std::bitset<256> bytes;
+				empty = false;
+				for (const std::string& literal : literals) {
+					if (literal.empty()) {
+						empty = true;
+					}
+					else {
+						bytes.set(static_cast<unsigned char>(literal.front()));
+					}
+				}
+				return bytes;
+			}
+
+			std::vector<std::string> literals;
+			bool empty = false;
+			// the bytes none of them start with.
+			ByteSet others;
+			bool paired = false;
+			char first = 0;
+			char last = 0;
+			size_t distance = 0;
+		};
+	}
+}
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_SLIDING_WINDOW_H
+#define FLOCK_COMPILER_SLIDING_WINDOW_H
+
+#include "Util.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace flock {
+	namespace supplier {
+
+		/// <summary>
+		/// How much a window is holding on to, and how much it has let go of.
+		/// </summary>
+		struct WindowStats {
+			// elements currently stored, committed or not.
+			size_t held = 0;
+			// elements at or after the commit point, the ones that can still be polled.
+			size_t live = 0;
+			// the most live elements there have ever been.
+			size_t peak = 0;
+			// elements released over the life of the window.
+			size_t released = 0;
+			// bytes reserved for the elements, whether used or not.
+			size_t capacityBytes = 0;
+			// the most live elements allowed, 0 if there is no limit.
+			size_t maxLive = 0;
+		};
+
+		/// <summary>
+		/// Holds the elements between the commit point and the end of what has been read, addressed by their absolute position.
+		///
+		/// Anything before the commit point can't be backtracked to, so it is released once there is enough of it to be worth moving the rest down.
+		/// The elements are always contiguous, so a run of them can be compared or viewed in place.
+		/// With a maxLive set, pushing past it throws rather than growing without bound.
+		/// </summary>
+		template<typename T>
+		class SlidingWindow {
+		public:
+			static const size_t UNBOUNDED = 0;
+			static const size_t DEFAULT_RELEASE_THRESHOLD = 4096;
+
+			SlidingWindow(const size_t maxLive = UNBOUNDED, const size_t releaseThreshold = DEFAULT_RELEASE_THRESHOLD)
+				: maxLive(maxLive), releaseThreshold(std::max<size_t>(1, releaseThreshold)) {}
+
+			/// <summary>
+			/// Position of the first element still held.
+			/// </summary>
+			int getBase() const {
+				return base;
+			}
+
+			/// <summary>
+			/// One past the position of the last element pushed.
+			/// </summary>
+			int getEnd() const {
+				return base + static_cast<int>(items.size());
+			}
+
+			/// <summary>
+			/// The lowest position that can still be asked for.
+			/// </summary>
+			int getCommitted() const {
+				return committed;
+			}
+
+			bool holds(const int position) const {
+				return position >= base && position < getEnd();
+			}
+
+			/// <summary>
+			/// The element at position, which must be held.
+			/// </summary>
+			const T& at(const int position) const {
+				return items[position - base];
+			}
+
+			/// <summary>
+			/// The element at getBase(), with the rest following on contiguously.
+			/// Only good until the next push or release.
+			/// </summary>
+			const T* data() const {
+				return items.data();
+			}
+
+			void push(const T& value) {
+				checkRoom(1);
+				items.push_back(value);
+				peak = std::max(peak, static_cast<size_t>(getEnd() - committed));
+			}
+
+			/// <summary>
+			/// Pushes count values in one go, converting them as it goes.
+			/// </summary>
+			template<typename U>
+			void append(const U* values, const int count) {
+				checkRoom(count);
+				items.insert(items.end(), values, values + count);
+				peak = std::max(peak, static_cast<size_t>(getEnd() - committed));
+			}
+
+			/// <summary>
+			/// How many more can be pushed before the commit point has to move.
+			/// </summary>
+			size_t room() const {
+				if (maxLive == UNBOUNDED) {
+					return SIZE_MAX;
+				}
+				return maxLive - std::min(maxLive, static_cast<size_t>(getEnd() - committed));
+			}
+
+			/// <summary>
+			/// Nothing before position will be asked for again.
+			/// The elements are only let go of on release, so anything that was looking at them can finish first.
+			/// </summary>
+			void commit(const int position) {
+				committed = std::max(committed, std::min(position, getEnd()));
+			}
+
+			/// <summary>
+			/// Whether release would actually move anything.
+			/// </summary>
+			bool worthReleasing() const {
+				const size_t releasable = static_cast<size_t>(committed - base);
+				return releasable >= releaseThreshold && releasable * 2 >= items.size();
+			}
+
+			/// <summary>
+			/// Lets go of everything before the commit point, if there is enough of it.
+			/// </summary>
+			void release() {
+				if (!worthReleasing()) {
+					return;
+				}
+				const size_t releasable = static_cast<size_t>(committed - base);
+				// at least half of what is held goes, so each element is only moved down a bounded number of times.
+				items.erase(items.begin(), items.begin() + releasable);
+				base = committed;
+				released += releasable;
+				// keep the reserved memory in proportion to what we hold.
+				if (items.capacity() > 4 * std::max(items.size(), releaseThreshold)) {
+					items.shrink_to_fit();
+				}
+			}
+
+			void clear() {
+				items.clear();
+				base = 0;
+				committed = 0;
+			}
+
+			WindowStats getStats() const {
+				WindowStats stats;
+				stats.held = items.size();
+				stats.live = static_cast<size_t>(getEnd() - committed);
+				stats.peak = peak;
+				stats.released = released;
+				stats.capacityBytes = items.capacity() * sizeof(T);
+				stats.maxLive = maxLive;
+				return stats;
+			}
+
+		protected:
+			void checkRoom(const int count) const {
+				if (room() < static_cast<size_t>(count)) {
+					throw string("Window of " + std::to_string(maxLive) + " exceeded at position " + std::to_string(getEnd()) + ", nothing before position " + std::to_string(committed) + " has been committed");
+				}
+			}
+
+			std::vector<T> items;
+			// position of items[0]
+			int base = 0;
+			int committed = 0;
+			size_t peak = 0;
+			size_t released = 0;
+			const size_t maxLive;
+			const size_t releaseThreshold;
+		};
+	}
+}
+#endif
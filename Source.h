@@ -17,11 +17,17 @@
 #ifndef FLOCK_COMPILER_SOURCE_H
 #define FLOCK_COMPILER_SOURCE_H
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <algorithm>
+#include <vector>
 #include "Util.h"
+#include "SimdScan.h"
  /*
   * Points to location within source code. Used for specifying debugging and breakpoints, and also for feedback as we build this.
-  * There are no actual pointers here, be aware that there is memory being copied, and that these are immutable.
+  * Be aware that there is memory being copied, and that these are immutable.
+  *
+  * While evaluating we only ever carry positions around, lines and columns are worked out from a LineIndex when someone asks for them.
   */
 namespace flock {
 	namespace source {
@@ -40,54 +46,161 @@ namespace flock {
 			friend std::ostream& operator<<(std::ostream& os, const Location& location) {
 				return os << "line: " << location.line << ", column: " << location.column << ", position: " << location.position << ", character: " << location.character;
 			};
+		};
+
+		/// <summary>
+		/// Where each line starts, so a position can be turned into a line and column with a binary search.
+		/// 
+		/// Bytes are handed over in order, and are scanned for line breaks in bulk.
+		/// A line starts after every '\n' or '\r', so "\r\n" counts twice, the same as it always has.
+		/// </summary>
+		class LineIndex {
+		public:
+			/// <summary>
+			/// Records the line breaks in the length bytes at data, which hold the positions from getScanned() onwards.
+			/// </summary>
+			void scan(const char* data, const int length) {
+				const int from = scanned;
+				simd::forEachNewLine(data, length, [this, from](const size_t offset) {
+					lineStarts.push_back(from + static_cast<int>(offset) + 1);
+				});
+				scanned += length;
+			}
+
+			/// <summary>
+			/// Everything before this position has been scanned.
+			/// </summary>
+			int getScanned() const {
+				return scanned;
+			}
+
+			/// <summary>
+			/// 1 based line, only meaningful for positions that have been scanned.
+			/// </summary>
+			int lineOf(const int position) const {
+				return static_cast<int>(std::upper_bound(lineStarts.begin(), lineStarts.end(), position) - lineStarts.begin());
+			}
 
-			///
-			/// Helper for the providing the next location, based on the previous location.
-			/// 
-			static const _sp<Location> next(_sp<Location> last, const int character) {
-				if (last) {
-					if (isNewLine(last->character)) {
-						return make_shared<Location>(last->line + 1, 1, last->position + 1, character);
-					}
-					return make_shared<Location>(last->line, last->column + 1, last->position + 1, character);
+			Location locate(const int position, const int character) const {
+				const int line = lineOf(position);
+				return Location(line, position - lineStarts[line - 1] + 1, position, character);
+			}
+
+			void clear() {
+				lineStarts.assign(1, 0);
+				scanned = 0;
+			}
+		protected:
+			std::vector<int> lineStarts = std::vector<int>(1, 0);
+			int scanned = 0;
+		};
+
+		/// <summary>
+		/// Source text addressed by position, that can say where a position is when asked.
+		/// </summary>
+		class SourceText {
+		public:
+			virtual ~SourceText() = default;
+			virtual Location locate(const int position) = 0;
+			/// <summary>
+			/// The text between start inclusive and end exclusive, in place.
+			/// Only good until the text next changes, so don't hang on to it.
+			/// </summary>
+			virtual std::string_view view(const int start, const int end) = 0;
+			/// <summary>
+			/// Whether the text between start and end is still there to view, a source that lets go of what has been consumed may not have it any more.
+			/// </summary>
+			virtual bool holds(const int start, const int end) = 0;
+
+			/// <summary>
+			/// The same as view, but throws if the text has been released, rather than handing back nothing.
+			/// </summary>
+			std::string_view viewHeld(const int start, const int end) {
+				if (!holds(start, end)) {
+					throw std::string("Unable to view the text from position " + std::to_string(start) + " to " + std::to_string(end) + ", its source has released it");
 				}
-				return make_shared<Location>(character);
+				return view(start, end);
 			}
 		};
 
+		/// <summary>
+		/// The text between start inclusive and end exclusive.
+		/// Only the positions are kept, the text is looked at in place, and only copied when asked for.
+		/// </summary>
 		struct Range {
-			Range(std::shared_ptr<Location> start)
-				: start{ start }, end{ start }, source(std::string({ (char)start->character })) {}
-			Range(const int character)
-				: Range{ std::make_shared<Location>(character) } {};
-			Range(std::shared_ptr<Location> start, std::shared_ptr<Location> end)
-				: start{ start }, end{ end }, source(std::string({ (char)start->character }) + std::string({ (char)end->character })) {}
-			Range(const Range start, std::shared_ptr<Location> end)
-				: start{ start.start }, end{ end }, source(start.source + std::string({ (char)end->character })) {}
+			Range(std::shared_ptr<SourceText> text, const int start, const int end)
+				: start{ start }, end{ end }, text(text) {}
 			Range(std::shared_ptr<Range> start, std::shared_ptr<Range> end)
-				: start{ start->start }, end{ end->end }, source(start->source + end->source) {}
+				: start{ start->start }, end{ end->end }, text(start->text) {}
+
+			Range(const Range& other) : start(other.start), end(other.end), text(other.text) {}
 
-			Range(const Range& other) : start(other.start), end(other.end), source(other.source) {}
+			const int start;
+			const int end;
 
-			const std::shared_ptr<Location> start;
-			const std::shared_ptr<Location> end;
-			const std::string source;
+			/// <summary>
+			/// Printed in place of text the source has since released.
+			/// </summary>
+			static constexpr const char* RELEASED = "<released>";
+
+			int size() const {
+				return end - start;
+			}
+
+			/// <summary>
+			/// Whether the source has let go of the text, which can happen to a range kept after the text it covers was consumed.
+			/// </summary>
+			bool isReleased() const {
+				return !text->holds(start, end);
+			}
+
+			/// <summary>
+			/// The text, in place, see SourceText::view for how long it is good for.
+			/// Throws if it has been released.
+			/// </summary>
+			std::string_view getSource() const {
+				return text->viewHeld(start, end);
+			}
+
+			std::string copySource() const {
+				return std::string(getSource());
+			}
+
+			const std::shared_ptr<SourceText>& getText() const {
+				return text;
+			}
+
+			Location getStart() const {
+				return text->locate(start);
+			}
+			/// <summary>
+			/// Location of the last character in the range.
+			/// </summary>
+			Location getEnd() const {
+				return text->locate(std::max(start, end - 1));
+			}
 
 			friend std::ostream& operator<<(std::ostream& os, const Range& range) {
-				return os << "start: {line: " << range.start->line << ", column: " << range.start->column << ", position: " << range.start->position << "}"
-					<< ", end: {line: " << range.end->line << ", column: " << range.end->column << ", position: " << range.end->position << "}, source: " << range.source;
+				const Location start = range.getStart();
+				const Location end = range.getEnd();
+				return os << "start: {line: " << start.line << ", column: " << start.column << ", position: " << start.position << "}"
+					<< ", end: {line: " << end.line << ", column: " << end.column << ", position: " << end.position << "}, source: " << (range.isReleased() ? std::string_view(RELEASED) : range.getSource());
 			};
 			std::string toStringNoText() {
+				const Location startLocation = getStart();
+				const Location endLocation = getEnd();
 				std::string ret;
-				ret.append("start: {line: ").append(std::to_string(start->line))
-					.append(", column: ").append(std::to_string(start->column))
-					.append(", position: ").append(std::to_string(start->position))
-					.append("}, end: {line: ").append(std::to_string(end->line))
-					.append(", column: ").append(std::to_string(end->column))
-					.append(", position: ").append(std::to_string(end->position))
-					.append("}, sourceLength: ").append(std::to_string(source.size()));
+				ret.append("start: {line: ").append(std::to_string(startLocation.line))
+					.append(", column: ").append(std::to_string(startLocation.column))
+					.append(", position: ").append(std::to_string(startLocation.position))
+					.append("}, end: {line: ").append(std::to_string(endLocation.line))
+					.append(", column: ").append(std::to_string(endLocation.column))
+					.append(", position: ").append(std::to_string(endLocation.position))
+					.append("}, sourceLength: ").append(std::to_string(size()));
 				return ret;
 			};
+		protected:
+			const std::shared_ptr<SourceText> text;
 		};
 
 		///*
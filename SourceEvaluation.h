@@ -17,12 +17,14 @@
 #define FLOCK_COMPILER_SOURCE_EVALUATION_H
 
 #include <iostream>
+#include <set>
 #include "Rules.h"
 #include "LogicRules.h"
 #include "StringRules.h"
 #include "RuleHistory.h"
 #include "LocationSupplier.h"
 #include "Syntax.h"
+#include "RuleAnalysis.h"
 
  ///
  /// Basic Grammar, that allows to employ basic BNF style grammars in language detection.
@@ -34,7 +36,7 @@ namespace flock {
 		using namespace flock::rule::types;
 		using namespace flock::rule::history;
 		namespace evaluator {
-			using Tokens = _sp<supplier::CachedSupplier<Location, _sp<Range>>>;
+			using Tokens = _sp<supplier::LocationSupplier>;
 			struct Input;
 			struct Output;
 			class SyntaxStrategies;
@@ -43,7 +45,7 @@ namespace flock {
 
 			struct Input {
 				Input(const Tokens tokens, const int idx) : idx(idx), tokens(tokens) {}
-				Input(const Tokens tokens) : idx(0), tokens(tokens) {}
+				Input(const Tokens tokens) : idx(tokens->getStart()), tokens(tokens) {}
 				Input(const Input& other) : idx{ other.idx }, tokens(other.tokens)
 				{ }
 
@@ -62,71 +64,163 @@ namespace flock {
 				Tokens tokens;
 			};
 
+			/// <summary>
+			/// The nodes an output carries, in order.
+			/// A rope, so joining two outputs is one small allocation, rather than a copy of both sides,
+			/// and a repeat of n nodes costs O(n) rather than O(n^2). Never changed once made, bar being taken apart as it is released, so memoised outputs can share it.
+			/// </summary>
+			class NodeRope {
+			public:
+				NodeRope(const _sp<SyntaxNode>& node) : node(node), count(1) {}
+				NodeRope(const _sp<const NodeRope>& left, const _sp<const NodeRope>& right) : left(left), right(right), count(left->count + right->count) {}
+
+				/// <summary>
+				/// A repeat of n nodes is a rope n deep, so the ropes only this one holds are released in a loop, rather than each by the one above it.
+				/// Those shared with another output are left to it.
+				/// </summary>
+				~NodeRope() {
+					if (!left && !right) {
+						return;
+					}
+					vector<_sp<const NodeRope>> pending;
+					const auto take = [&pending](_sp<const NodeRope>& rope) {
+						if (rope && rope.use_count() == 1) {
+							pending.push_back(std::move(rope));
+						}
+					};
+					take(left);
+					take(right);
+					while (!pending.empty()) {
+						// released at the end of the loop, with nothing left under it that it alone holds.
+						const _sp<const NodeRope> rope = std::move(pending.back());
+						pending.pop_back();
+						take(rope->left);
+						take(rope->right);
+					}
+				}
+
+				size_t size() const {
+					return count;
+				}
+
+				/// <summary>
+				/// Calls f with each node in order.
+				/// Repeats build deep ropes, so this walks them with a stack of its own rather than recursing.
+				/// </summary>
+				template<typename F>
+				void forEach(F f) const {
+					vector<const NodeRope*> pending = { this };
+					while (!pending.empty()) {
+						const NodeRope* rope = pending.back();
+						pending.pop_back();
+						if (rope->node) {
+							f(rope->node);
+						}
+						else {
+							pending.push_back(rope->right.get());
+							pending.push_back(rope->left.get());
+						}
+					}
+				}
+
+				_sp_vec<SyntaxNode> flatten() const {
+					_sp_vec<SyntaxNode> nodes;
+					nodes.reserve(count);
+					forEach([&](const _sp<SyntaxNode>& node) { nodes.push_back(node); });
+					return nodes;
+				}
+
+			protected:
+				// a leaf holds a node, anything else joins left and right, which are only ever moved from by ~NodeRope, once nothing else holds them.
+				_sp<SyntaxNode> node;
+				mutable _sp<const NodeRope> left;
+				mutable _sp<const NodeRope> right;
+				size_t count;
+			};
+
 			struct Output {
-				Output(int idx, _sp_vec<SyntaxNode>	syntaxNodes) : idx(idx), syntaxNodes(syntaxNodes) {}
-				Output(int idx, _sp<SyntaxNode>	syntaxNode) : idx(idx), syntaxNodes({ syntaxNode }) {}
+				Output(int idx, _sp<const NodeRope> nodes) : idx(idx), nodes(std::move(nodes)) {}
+				Output(int idx, const _sp<SyntaxNode>& syntaxNode) : idx(idx), nodes(make_shared<const NodeRope>(syntaxNode)) {}
 				Output(int idx) : idx(idx) {}
-				bool isFailure() {
+				bool isFailure() const {
 					return idx < 0;
 				}
-				bool isSuccess() {
+				bool isSuccess() const {
 					return idx >= 0;
 				}
-				bool hasNodes() {
-					return !syntaxNodes.empty();
+				bool hasNodes() const {
+					return nodes != nullptr;
+				}
+				/// <summary>
+				/// The nodes, copied out of the rope.
+				/// </summary>
+				_sp_vec<SyntaxNode> getNodes() const {
+					return nodes ? nodes->flatten() : _sp_vec<SyntaxNode>();
+				}
+				/// <summary>
+				/// The nodes, less any empty ones, for a parent to adopt as they are.
+				/// </summary>
+				_sp_vec<SyntaxNode> getChildNodes() const {
+					_sp_vec<SyntaxNode> children;
+					if (nodes) {
+						children.reserve(nodes->size());
+						nodes->forEach([&](const _sp<SyntaxNode>& child) {
+							if (child) {
+								children.push_back(child);
+							}
+						});
+					}
+					return children;
+				}
+				template<typename F>
+				void forEachNode(F f) const {
+					if (nodes) {
+						nodes->forEach(f);
+					}
 				}
 				int idx;
-				_sp_vec<SyntaxNode>	syntaxNodes;
+				_sp<const NodeRope> nodes;
 			};
 
 			const static Output FAILURE = Output(-1);
 
-			class EvaluationMixins : public BaseMixinsCombined<Input, Output>, public LogicMixinsCombined<Input, Output>, public HistoryMixinsCombined<Input, Output, Key> {
+			class EvaluationMixins : public virtual BaseMixinsCombined<Input, Output>, public LogicMixinsCombined<Input, Output>, public HistoryMixinsCombined<Input, Output, Key> {
 			public:
-				virtual bool isFailure(Output out) override {
+				virtual bool isFailure(const Output& out) override {
 					return out.isFailure();
 				}
 				virtual Output makeFailure() override {
 					return FAILURE;
 				}
-				virtual Output makeSuccess(Input input) override {
+				virtual Output makeSuccess(const Input& input) override {
 					return Output(input.idx + 1);
 				}
-				virtual Output makeEmptySuccess(Input input) override {
+				virtual Output makeEmptySuccess(const Input& input) override {
 					return Output(input.idx);
 				}
-				virtual bool isEnd(Input input) override {
-					Tokens tokens = input.tokens;
-					return tokens->isEnd(input.idx);
-				}
-				virtual Input nextInFromPrevious(Input previousInput, Output previousOutput) override {
-					return previousInput.next(previousOutput.idx);
-				}
-				virtual Output joinOutputs(Output first, Output second) override {
-					if (first.hasNodes()) {
-						if (second.hasNodes()) {
-							_sp_vec<SyntaxNode> nodes;
-							nodes.reserve(first.syntaxNodes.size() + second.syntaxNodes.size()); // preallocate memory
-							nodes.insert(nodes.end(), first.syntaxNodes.begin(), first.syntaxNodes.end());
-							nodes.insert(nodes.end(), second.syntaxNodes.begin(), second.syntaxNodes.end());
-							return Output(second.idx, nodes);
-						}
-						else {
-							return Output(second.idx, first.syntaxNodes);
-						}
-					}
-					else {
+				virtual bool isEnd(const Input& input) override {
+					return input.tokens->isEnd(input.idx);
+				}
+				virtual Input nextInFromPrevious(const Input& previousInput, const Output& previousOutput) override {
+					return Input(previousInput.tokens, previousOutput.idx);
+				}
+				virtual bool hasMoved(const Input& from, const Input& to) override {
+					return to.idx > from.idx;
+				}
+				/// <summary>
+				/// One allocation at most, whatever either side holds.
+				/// </summary>
+				virtual Output joinOutputs(const Output& first, const Output& second) override {
+					if (!first.hasNodes()) {
 						return second;
 					}
-				}
-				virtual Key getKeyForInput(Input input) override {
-					const int idx = input.idx;
-					const Tokens tokens = input.tokens;
-					auto location = tokens->poll(idx);
-					if (location) {
-						return location->position;
+					if (!second.hasNodes()) {
+						return Output(second.idx, first.nodes);
 					}
-					return -1;
+					return Output(second.idx, make_shared<const NodeRope>(first.nodes, second.nodes));
+				}
+				virtual Key getKeyForInput(const Input& input) override {
+					return input.idx;
 				}
 			};
 
@@ -134,50 +228,69 @@ namespace flock {
 			public:
 				HasCharRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : HasValueRuleStrategy<int, Input, Output>(mixins) {}
 
-				virtual Output matches(int value, Input input) override {
+				virtual Output matches(const int& value, Input input) override {
 					const int idx = input.idx;
 					const Tokens tokens = input.tokens;
-					auto location = tokens->poll(idx);
-					if (location && value == location->character) {
+					if (value == tokens->poll(idx)) {
 						return Output(idx + 1);
 					}
 					return FAILURE;
 				}
 			};
 
-			class HasStringRuleStrategy : public HasValueRuleStrategy<string, Input, Output> {
+			/// <summary>
+			/// Matches the longest of the strings, one on its own with a compare in place, several with a walk of a trie of them, made the first time the rule is seen.
+			/// </summary>
+			class StringRuleStrategy : public TypedMixinsRuleStrategy<Input, Output, ValuesRule<string>, StringRuleStrategy> {
 			public:
-				HasStringRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : HasValueRuleStrategy<string, Input, Output>(mixins) {}
+				StringRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : TypedMixinsRuleStrategy<Input, Output, ValuesRule<string>, StringRuleStrategy>(mixins) {}
 
-				virtual Output matches(string value, Input input) override {
-					const int idx = input.idx;
-					const Tokens tokens = input.tokens;
-					auto range = tokens->pollRange(value.size(), idx);
-					if (range && value == range->source) {
-						return Output(idx + value.size());
+				Output acceptTyped(const _sp<EvaluationVisitor>&, ValuesRule<string>& rule, const Input& input) {
+					if (mixins->isEnd(input)) {
+						return FAILURE;
 					}
-					return FAILURE;
+					const vector<string>& values = rule.getValues();
+					if (values.size() == 1) {
+						return input.tokens->startsWith(input.idx, values.front()) ? Output(input.idx + static_cast<int>(values.front().size())) : FAILURE;
+					}
+					const Tokens& tokens = input.tokens;
+					const int length = trieFor(rule).longestAt(input.idx, [&tokens](const int position) { return tokens->poll(position); });
+					return length >= 0 ? Output(input.idx + length) : FAILURE;
+				}
+
+			protected:
+				const StringTrie& trieFor(ValuesRule<string>& rule) {
+					const size_t id = static_cast<size_t>(rule.id);
+					if (tries.size() <= id) {
+						tries.resize(id + 1);
+					}
+					if (!tries[id]) {
+						tries[id] = make_shared<StringTrie>(rule.getValues());
+					}
+					return *tries[id];
 				}
+
+				// indexed by rule id, a rule's strings never change.
+				vector<_sp<StringTrie>> tries;
 			};
 
-			class CharRangeRuleStrategy : public MixinsRuleStrategy<Input, Output> {
+			class CharRangeRuleStrategy : public TypedMixinsRuleStrategy<Input, Output, ValuesRule<int>, CharRangeRuleStrategy> {
 			public:
-				CharRangeRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : MixinsRuleStrategy< Input, Output>(mixins) {}
+				CharRangeRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : TypedMixinsRuleStrategy<Input, Output, ValuesRule<int>, CharRangeRuleStrategy>(mixins) {}
 
-				virtual Output accept(const _sp<EvaluationVisitor> visitor, const _sp<Rule> baseRule, const Input input) override {
+				Output acceptTyped(const _sp<EvaluationVisitor>&, ValuesRule<int>& rule, const Input& input) {
 					if (mixins->isEnd(input)) {
 						return FAILURE;
 					}
-					const auto rule = std::dynamic_pointer_cast<ValuesRule<int>>(baseRule);
-					const vector<int> values = rule->getValues();
+					const vector<int>& values = rule.getValues();
 
 					const int start = values.at(0);
 					const int end = values.at(1);
 					const int idx = input.idx;
 					const Tokens tokens = input.tokens;
-					auto location = tokens->poll(idx);
+					const int character = tokens->poll(idx);
 
-					if (location && start <= location->character && end >= location->character) {
+					if (character != EOF && start <= character && end >= character) {
 						return Output(idx + 1);
 					}
 					return FAILURE; // return failure.
@@ -185,16 +298,377 @@ namespace flock {
 
 			};
 
+			class CharClassRuleStrategy : public TypedMixinsRuleStrategy<Input, Output, CharClassRule, CharClassRuleStrategy> {
+			public:
+				CharClassRuleStrategy(_sp<BaseMixinsCombined<Input, Output>> mixins) : TypedMixinsRuleStrategy<Input, Output, CharClassRule, CharClassRuleStrategy>(mixins) {}
+
+				Output acceptTyped(const _sp<EvaluationVisitor>&, CharClassRule& rule, const Input& input) {
+					const Tokens& tokens = input.tokens;
+					const int length = rule.matchAt(input.idx, [&tokens](const int position) { return tokens->poll(position); });
+					return length > 0 ? Output(input.idx + length) : FAILURE;
+				}
+			};
+
+			/// <summary>
+			/// The farthest any terminal rule got before failing, the usual place to report a syntax error.
+			/// Failures inside a lookahead are what it is looking for, so they don't count, but the farthest of them is kept aside, see RememberedFailureRuleStrategy.
+			/// </summary>
+			class FailureTracker {
+			public:
+				void failedAt(const int position) {
+					if (quiet == 0) {
+						farthest = std::max(farthest, position);
+					}
+					else {
+						quietFarthest = std::max(quietFarthest, position);
+					}
+				}
+				/// <summary>
+				/// The farthest failure, -1 if nothing has failed.
+				/// </summary>
+				int getFarthest() const {
+					return farthest;
+				}
+				void enterLookahead() {
+					quiet++;
+				}
+				void leaveLookahead() {
+					quiet--;
+				}
+				bool isQuiet() const {
+					return quiet > 0;
+				}
+				/// <summary>
+				/// The farthest failure inside a lookahead since this was last called, -1 if there wasn't one.
+				/// </summary>
+				int takeQuietFarthest() {
+					const int taken = quietFarthest;
+					quietFarthest = -1;
+					return taken;
+				}
+				void keepQuietFarthest(const int position) {
+					quietFarthest = std::max(quietFarthest, position);
+				}
+				void reset() {
+					farthest = -1;
+					quietFarthest = -1;
+					quiet = 0;
+				}
+			protected:
+				int farthest = -1;
+				int quietFarthest = -1;
+				int quiet = 0;
+			};
+
+			/// <summary>
+			/// How often a rule was checked against its first set, and how often that meant it wasn't tried at all.
+			/// </summary>
+			struct PruneStats {
+				size_t checked = 0;
+				size_t skipped = 0;
+			};
+
+			/// <summary>
+			/// The checks made under a symbol or part, the symbol itself tried at the top level, and the alternatives of its ors.
+			/// </summary>
+			struct ProductionPruning {
+				string name;
+				PruneStats trials;
+				PruneStats alternatives;
+			};
+
+			/// <summary>
+			/// Says whether a rule is worth trying on a character, by its first set, counting rule by rule how often it wasn't.
+			/// The first sets are worked out the first time a library is seen.
+			/// Given a tracker, a rule that isn't tried fails where it would have been, the same as its first character would have.
+			/// </summary>
+			class FirstSetPruning {
+			public:
+				FirstSetPruning(_sp<FailureTracker> tracker = nullptr) : tracker(tracker) {}
+
+				bool canStart(const _sp<RuleLibrary>& library, const Rule& rule, const int position, const int character) {
+					if (library != bound) {
+						bind(library);
+					}
+					PruneStats& counted = statsFor(rule.id);
+					counted.checked++;
+					if (sets->canStartWith(rule, character)) {
+						return true;
+					}
+					counted.skipped++;
+					if (tracker) {
+						tracker->failedAt(position);
+					}
+					return false;
+				}
+
+				void setTracker(_sp<FailureTracker> trackerToSet) {
+					tracker = trackerToSet;
+				}
+
+				/// <summary>
+				/// The first sets of the last library seen, nullptr before there was one.
+				/// </summary>
+				_sp<analysis::FirstSets> getFirstSets() {
+					return sets;
+				}
+
+				/// <summary>
+				/// The checks made, totalled by the symbol or part they were made under, for the last library seen.
+				/// </summary>
+				vector<ProductionPruning> byProduction() {
+					vector<ProductionPruning> totals;
+					if (!sets) {
+						return totals;
+					}
+					for (const string& name : sets->getProductionNames()) {
+						totals.push_back(ProductionPruning{ name, PruneStats(), PruneStats() });
+					}
+					for (size_t id = 0; id < stats.size(); id++) {
+						const int production = sets->productionOf(static_cast<int>(id));
+						if (production < 0) {
+							continue;
+						}
+						PruneStats& total = sets->isProduction(static_cast<int>(id)) ? totals[production].trials : totals[production].alternatives;
+						total.checked += stats[id].checked;
+						total.skipped += stats[id].skipped;
+					}
+					return totals;
+				}
+
+			protected:
+				void bind(const _sp<RuleLibrary>& library) {
+					bound = library;
+					sets = make_shared<analysis::FirstSets>(library);
+				}
+
+				PruneStats& statsFor(const int ruleId) {
+					if (stats.size() <= static_cast<size_t>(ruleId)) {
+						stats.resize(ruleId + 1);
+					}
+					return stats[ruleId];
+				}
+
+				_sp<FailureTracker> tracker;
+				_sp<RuleLibrary> bound;
+				_sp<analysis::FirstSets> sets;
+				// indexed by rule id.
+				vector<PruneStats> stats;
+			};
+
+			/// <summary>
+			/// Tries the alternatives in order, the same as the OrRuleStrategy, bar those that can't start with the character they would be tried on.
+			/// </summary>
+			class FirstSetOrRuleStrategy : public TypedMixinsRuleStrategy<Input, Output, CollectionRule, FirstSetOrRuleStrategy> {
+			public:
+				FirstSetOrRuleStrategy(_sp<FirstSetPruning> pruning, _sp<BaseMixinsCombined<Input, Output>> mixins) : TypedMixinsRuleStrategy<Input, Output, CollectionRule, FirstSetOrRuleStrategy>(mixins), pruning(pruning) {}
+
+				Output acceptTyped(const _sp<EvaluationVisitor>& visitor, CollectionRule& rule, const Input& input) {
+					const int character = input.tokens->poll(input.idx);
+					for (const _sp<Rule>& child : rule.getChildren()) {
+						if (!pruning->canStart(visitor->getLibrary(), *child, input.idx, character)) {
+							continue;
+						}
+						const Output output = visitor->visit(child, input);
+						if (output.isSuccess()) {
+							return output;
+						}
+					}
+					return FAILURE;
+				}
+			protected:
+				_sp<FirstSetPruning> pruning;
+			};
+
+			/// <summary>
+			/// Has ors skip the alternatives that can't start where they are, in place of the OrRuleStrategy they are given.
+			/// Wraps everything else, so it goes outside any caching, and what it skips costs nothing.
+			/// </summary>
+			class FirstSetStrategies : public types::WrappingStrategies<Input, Output> {
+			public:
+				FirstSetStrategies(_sp<types::Strategies<Input, Output>> strategies, _sp<FirstSetPruning> pruning, _sp<BaseMixinsCombined<Input, Output>> mixins) :
+					types::WrappingStrategies<Input, Output>(strategies), pruning(pruning), mixins(mixins) {}
+
+				virtual void addStrategy(const int type, _sp<RuleStrategy<Input, Output>> strategy) override {
+					if (type == LogicRules::Or) {
+						getWrappedStratagies()->addStrategy(type, make_shared<FirstSetOrRuleStrategy>(pruning, mixins));
+						return;
+					}
+					getWrappedStratagies()->addStrategy(type, strategy);
+				}
+
+				_sp<FirstSetPruning> getPruning() {
+					return pruning;
+				}
+			protected:
+				_sp<FirstSetPruning> pruning;
+				_sp<BaseMixinsCombined<Input, Output>> mixins;
+			};
+
+			/// <summary>
+			/// A run the source can be scanned for in one go, of bytes from a set, or of anything up to the first of a set of literals.
+			/// </summary>
+			struct CharacterSpan {
+				_sp<simd::ByteSet> bytes;
+				_sp<simd::LiteralSet> until;
+
+				/// <summary>
+				/// How long the run from position is.
+				/// </summary>
+				int scan(const Tokens& tokens, const int position) const {
+					return bytes ? tokens->spanOf(position, *bytes) : tokens->spanUntil(position, *until);
+				}
+			};
+
+			/// <summary>
+			/// The repeats that can be matched with one scan of the source, those with no maximum over a single class of bytes,
+			/// be it written as characters, ranges, buts or ors of them, or as aliases to parts that are nothing more,
+			/// and those over a but of strings and characters, an UNTIL of a literal, which go up to the first of them.
+			/// Each is worked out the first time it is seen, for the library it was seen in.
+			/// </summary>
+			class CharacterSpans {
+			public:
+				/// <summary>
+				/// The run the repeat goes over, nullptr if it has to be matched a repeat at a time.
+				/// </summary>
+				const CharacterSpan* of(const _sp<RuleLibrary>& library, RepeatRule& rule) {
+					if (library != bound) {
+						bound = library;
+						spans.clear();
+					}
+					const size_t id = static_cast<size_t>(rule.id);
+					if (spans.size() <= id) {
+						spans.resize(id + 1);
+					}
+					Known& known = spans[id];
+					if (!known.known) {
+						known.span = find(library, rule);
+						known.known = true;
+					}
+					return known.span.get();
+				}
+
+				/// <summary>
+				/// Works out the run the repeat goes over, without remembering it, nullptr if it can't be scanned.
+				/// </summary>
+				static _sp<CharacterSpan> find(const _sp<RuleLibrary>& library, RepeatRule& rule) {
+					// one with a maximum fails on too many, and is rare enough to be left as it is.
+					if (rule.getMax() != 0) {
+						return nullptr;
+					}
+					std::set<string> followed;
+					const auto part = [&library, &followed](const string& name) -> _sp<Rule> {
+						// symbols make nodes, and a part seen already could be one that refers back to itself.
+						if (library->getSymbol(name) || !followed.insert(name).second) {
+							return nullptr;
+						}
+						return library->getPart(name);
+					};
+					bitset<256> bytes;
+					vector<pair<int, int>> codePoints;
+					if (analysis::collectCharacters(rule.getChild(), part, bytes, codePoints) && codePoints.empty()) {
+						const _sp<CharacterSpan> span = make_shared<CharacterSpan>();
+						span->bytes = make_shared<simd::ByteSet>(bytes);
+						return span;
+					}
+					followed.clear();
+					_sp<Rule> child = rule.getChild();
+					while (child && child->type == LogicRules::Alias) {
+						child = part(static_cast<AliasRule&>(*child).getAlias());
+					}
+					vector<string> literals;
+					if (!child || child->type != LogicRules::AnyBut || !analysis::collectLiterals(static_cast<UnaryRule&>(*child).getChild(), part, literals)) {
+						return nullptr;
+					}
+					const _sp<CharacterSpan> span = make_shared<CharacterSpan>();
+					span->until = make_shared<simd::LiteralSet>(literals);
+					return span;
+				}
+
+			protected:
+				struct Known {
+					bool known = false;
+					_sp<CharacterSpan> span;
+				};
+
+				_sp<RuleLibrary> bound;
+				// indexed by rule id.
+				vector<Known> spans;
+			};
+
+			/// <summary>
+			/// Matches a repeat the spans can scan for by scanning for the end of the run, with one output for all of it, and anything else as the strategy it wraps.
+			/// Given a tracker, the repeat fails where the scan stopped, the same as its last try would have.
+			/// </summary>
+			class SpanRepeatRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				SpanRepeatRuleStrategy(_sp<CharacterSpans> spans, _sp<FailureTracker> tracker, _sp<RuleStrategy<Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped), spans(spans), tracker(tracker) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					RepeatRule& rule = visitor::nodeAs<RepeatRule>(baseRule);
+					const CharacterSpan* span = spans->of(visitor->getLibrary(), rule);
+					if (!span) {
+						return wrapped->accept(visitor, baseRule, input);
+					}
+					const int length = span->scan(input.tokens, input.idx);
+					if (tracker) {
+						tracker->failedAt(input.idx + length);
+					}
+					if (length < rule.getMin()) {
+						return FAILURE;
+					}
+					return Output(input.idx + length);
+				}
+			protected:
+				_sp<CharacterSpans> spans;
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Has the repeats the spans can scan for scan the source, in place of the RepeatRuleStrategy they are given.
+			/// Goes outside the other strategies, so anything they wrap a repeat with, caching or recording, wraps the scan too.
+			/// </summary>
+			class SpanStrategies : public types::WrappingStrategies<Input, Output> {
+			public:
+				SpanStrategies(_sp<types::Strategies<Input, Output>> strategies, _sp<CharacterSpans> spans, _sp<FailureTracker> tracker = nullptr) :
+					types::WrappingStrategies<Input, Output>(strategies), spans(spans), tracker(tracker) {}
+
+				virtual void addStrategy(const int type, _sp<RuleStrategy<Input, Output>> strategy) override {
+					if (type == LogicRules::Repeat) {
+						getWrappedStratagies()->addStrategy(type, make_shared<SpanRepeatRuleStrategy>(spans, tracker, strategy));
+						return;
+					}
+					getWrappedStratagies()->addStrategy(type, strategy);
+				}
+
+				_sp<CharacterSpans> getSpans() {
+					return spans;
+				}
+			protected:
+				_sp<CharacterSpans> spans;
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Tries every symbol, and keeps the longest, skipping those the pruning, if there is one, says can't start here.
+			/// </summary>
 			class EvaluationLibraryStrategy : public LibraryStrategy<Input, Output> {
 			public:
+				EvaluationLibraryStrategy(_sp<FirstSetPruning> pruning = nullptr) : pruning(pruning) {}
+
 				virtual Output accept(_sp<EvaluationVisitor> visitor, _sp<RuleLibrary> library, Input input) override {
 					vector<string> symbolNames = library->getSymbolNames();
 					Output out = FAILURE;
 					string name = "";
+					const int character = input.tokens->poll(input.idx);
 
 					for (auto rule = symbolNames.begin(); rule != symbolNames.end(); ++rule) {
 						try {
-							Output newOut = visitor->visitByName(*rule, input);
+							const _sp<Rule> symbol = library->getSymbol(*rule);
+							if (pruning && symbol && !pruning->canStart(library, *symbol, input.idx, character)) {
+								continue;
+							}
+							Output newOut = visitor->visitSymbol(*rule, symbol, input);
 							if (newOut.idx > out.idx) {
 								name = *rule;
 								out = newOut;
@@ -205,20 +679,14 @@ namespace flock {
 						}
 					}
 					if (out.isSuccess()) {
-						auto evaluated = input.tokens->popRange(out.idx - input.idx);
-
-						_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(name, input.tokens->pollRangeBetween(input.idx, out.idx));
-						if (out.hasNodes()) {
-							for (_sp<SyntaxNode> child : out.syntaxNodes) {
-								if (child) {
-									syntaxNode->append(child->clone());
-								}
-							}
-						}
+						_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(name, input.tokens->pollRangeBetween(input.idx, out.idx), out.getChildNodes());
+						input.tokens->popRange(out.idx - input.idx);
 						return Output(out.idx, syntaxNode);
 					}
 					return out; // return the first as a success
 				};
+			protected:
+				_sp<FirstSetPruning> pruning;
 			};
 
 
@@ -227,23 +695,46 @@ namespace flock {
 				SyntaxAliasRuleStrategy(_sp<RuleStrategy <Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped) {}
 
 				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
-					const auto rule = std::dynamic_pointer_cast<AliasRule>(baseRule);
-					Output output = wrapped->accept(visitor, rule, input);
-					if (output.isSuccess() && visitor->getSymbol(rule->getAlias())) {
-						_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(rule->getAlias(), input.tokens->pollRangeBetween(input.idx, output.idx));
-						if (output.hasNodes()) {
-							for (_sp<SyntaxNode> child : output.syntaxNodes) {
-								if (child) {
-									syntaxNode->append(child->clone());
-								}
-							}
-						}
+					Output output = wrapped->accept(visitor, baseRule, input);
+					AliasRule& rule = visitor::nodeAs<AliasRule>(baseRule);
+					if (output.isSuccess() && (rule.isBound() ? rule.isSymbol() : visitor->getSymbol(rule.getAlias()) != nullptr)) {
+						_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(rule.getAlias(), input.tokens->pollRangeBetween(input.idx, output.idx), output.getChildNodes());
 						return Output(output.idx, syntaxNode);
 					}
 					return output;
 				}
 			};
 
+			/// <summary>
+			/// Nests the chain by precedence, each operator a node of its name over what it joins, the operands either side and any nodes of the operator itself.
+			/// </summary>
+			class SyntaxOperatorsRuleStrategy : public OperatorsRuleStrategy<Input, Output> {
+			public:
+				SyntaxOperatorsRuleStrategy(_sp<LogicMixinsCombined<Input, Output>> mixins) : OperatorsRuleStrategy<Input, Output>(mixins) {}
+
+			protected:
+				virtual Output fold(OperatorsRule& rule, const Input& input, const vector<Output>& operands, const vector<pair<int, Output>>& operators) override {
+					if (operators.empty()) {
+						return operands.front();
+					}
+					vector<int> matched;
+					matched.reserve(operators.size());
+					for (const auto& op : operators) {
+						matched.push_back(op.first);
+					}
+					// what each operand has been folded into so far, by the first operand in it.
+					vector<Output> folded = operands;
+					for (const OperatorsRule::Fold& fold : rule.fold(matched)) {
+						const int start = fold.first == 0 ? input.idx : operators[fold.first - 1].second.idx;
+						const int end = operands[fold.last].idx;
+						const Output joined = mixins->joinOutputs(mixins->joinOutputs(folded[fold.first], operators[fold.op].second), folded[fold.op + 1]);
+						const string& name = rule.getOperators()[operators[fold.op].first].name;
+						folded[fold.first] = Output(end, make_shared<SyntaxNode>(name, input.tokens->pollRangeBetween(start, end), joined.getChildNodes()));
+					}
+					return folded.front();
+				}
+			};
+
 			class SyntaxStrategies : public types::WrappingStrategies<Input, Output> {
 			public:
 				SyntaxStrategies(_sp<types::Strategies<Input, Output>> strategies) :
@@ -260,19 +751,301 @@ namespace flock {
 				}
 			};
 
+			/// <summary>
+			/// Tells the tracker where the rule it wraps failed.
+			/// </summary>
+			class FailureTrackingRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				FailureTrackingRuleStrategy(_sp<FailureTracker> tracker, _sp<RuleStrategy<Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped), tracker(tracker) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					Output output = wrapped->accept(visitor, baseRule, input);
+					if (output.isFailure()) {
+						tracker->failedAt(input.idx);
+					}
+					return output;
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Tells the tracker where the string it wraps failed, which is as far as the source followed the longest of its strings,
+			/// so a string fails where the sequence of its characters would have, and joining them up doesn't move the farthest failure.
+			/// </summary>
+			class StringFailureTrackingRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				StringFailureTrackingRuleStrategy(_sp<FailureTracker> tracker, _sp<RuleStrategy<Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped), tracker(tracker) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					Output output = wrapped->accept(visitor, baseRule, input);
+					if (output.isFailure()) {
+						int followed = 0;
+						for (const string& value : visitor::nodeAs<ValuesRule<string>>(baseRule).getValues()) {
+							int length = 0;
+							while (length < static_cast<int>(value.size()) && input.tokens->poll(input.idx + length) == static_cast<unsigned char>(value[length])) {
+								length++;
+							}
+							followed = std::max(followed, length);
+						}
+						tracker->failedAt(input.idx + followed);
+					}
+					return output;
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Keeps the failures under a lookahead from the tracker.
+			/// </summary>
+			class LookaheadRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				LookaheadRuleStrategy(_sp<FailureTracker> tracker, _sp<RuleStrategy<Input, Output>> wrapped) : WrappingRuleStrategy<Input, Output>(wrapped), tracker(tracker) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					tracker->enterLookahead();
+					try {
+						Output output = wrapped->accept(visitor, baseRule, input);
+						tracker->leaveLookahead();
+						return output;
+					}
+					catch (...) {
+						tracker->leaveLookahead();
+						throw;
+					}
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Where each rule failed farthest, inside a lookahead, by rule and start, cleared along with the memo table.
+			/// </summary>
+			using QuietFailures = MemoTable<int>;
+
+			/// <summary>
+			/// Goes around the caching, so a rule answered from the memo table reports the failures it kept quiet when it was first run, inside a lookahead,
+			/// the same as it would have, run again outside one. Until something has failed inside a lookahead, it only passes the visit on.
+			/// </summary>
+			class RememberedFailureRuleStrategy : public WrappingRuleStrategy<Input, Output> {
+			public:
+				RememberedFailureRuleStrategy(_sp<FailureTracker> tracker, _sp<QuietFailures> failures, _sp<RuleStrategy<Input, Output>> wrapped) :
+					WrappingRuleStrategy<Input, Output>(wrapped), tracker(tracker), failures(failures) {}
+
+				virtual Output accept(_sp<RuleVisitor<Input, Output>> visitor, _sp<Rule> baseRule, Input input) override {
+					if (!tracker->isQuiet() && failures->size() == 0) {
+						return wrapped->accept(visitor, baseRule, input);
+					}
+					// what was kept quiet before this rule, which it mustn't be blamed for.
+					const int before = tracker->takeQuietFarthest();
+					Output output = wrapped->accept(visitor, baseRule, input);
+					const MemoEntry* remembered = failures->find(baseRule->id, input.idx);
+					if (remembered) {
+						tracker->failedAt(failures->getCompleted(*remembered));
+					}
+					const int quietFarthest = tracker->takeQuietFarthest();
+					if (quietFarthest >= 0 && tracker->isQuiet() && !remembered) {
+						failures->setCompleted(baseRule->id, input.idx, quietFarthest);
+					}
+					tracker->keepQuietFarthest(std::max(before, quietFarthest));
+					return output;
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+				_sp<QuietFailures> failures;
+			};
+
+			/// <summary>
+			/// Has every rule remember what it failed at quietly. The caching is given these to wrap, so what it adds goes around the memo table.
+			/// </summary>
+			class RememberedFailureStrategies : public types::WrappingStrategies<Input, Output> {
+			public:
+				RememberedFailureStrategies(_sp<types::Strategies<Input, Output>> strategies, _sp<FailureTracker> tracker) :
+					types::WrappingStrategies<Input, Output>(strategies), tracker(tracker), failures(make_shared<QuietFailures>()) {}
+
+				virtual void addStrategy(const int type, _sp<RuleStrategy<Input, Output>> strategy) override {
+					getWrappedStratagies()->addStrategy(type, make_shared<RememberedFailureRuleStrategy>(tracker, failures, strategy));
+				}
+
+				virtual void clear() override {
+					failures->clear();
+					types::WrappingStrategies<Input, Output>::clear();
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+				_sp<QuietFailures> failures;
+			};
+
+			/// <summary>
+			/// No syntax nodes, just where each rule ended, and the farthest any terminal failed.
+			/// </summary>
+			class RecognitionStrategies : public types::WrappingStrategies<Input, Output> {
+			public:
+				RecognitionStrategies(_sp<types::Strategies<Input, Output>> strategies, _sp<FailureTracker> tracker) :
+					types::WrappingStrategies<Input, Output>(strategies), tracker(tracker) {}
+
+				virtual void addStrategy(const int type, _sp<RuleStrategy<Input, Output>> strategy) override {
+					switch (type) {
+					case StringRules::EqualString:
+						getWrappedStratagies()->addStrategy(type, make_shared<StringFailureTrackingRuleStrategy>(tracker, strategy));
+						return;
+					case StringRules::EqualChar:
+					case StringRules::CharRange:
+					case StringRules::CharClass:
+					case LogicRules::Any:
+					case LogicRules::End:
+						getWrappedStratagies()->addStrategy(type, make_shared<FailureTrackingRuleStrategy>(tracker, strategy));
+						return;
+					case LogicRules::Not:
+						getWrappedStratagies()->addStrategy(type, make_shared<LookaheadRuleStrategy>(tracker, strategy));
+						return;
+					case LogicRules::AnyBut:
+						// what it excludes is a lookahead, but it still fails where it is, like any other character.
+						getWrappedStratagies()->addStrategy(type, make_shared<FailureTrackingRuleStrategy>(tracker, make_shared<LookaheadRuleStrategy>(tracker, strategy)));
+						return;
+					default:
+						getWrappedStratagies()->addStrategy(type, strategy);
+					}
+				}
+
+				_sp<FailureTracker> getTracker() {
+					return tracker;
+				}
+			protected:
+				_sp<FailureTracker> tracker;
+			};
+
+			/// <summary>
+			/// Tries every symbol, and keeps the longest, the same as the EvaluationLibraryStrategy does, without making a node for it.
+			/// </summary>
+			class RecognitionLibraryStrategy : public LibraryStrategy<Input, Output> {
+			public:
+				RecognitionLibraryStrategy(_sp<FirstSetPruning> pruning = nullptr) : pruning(pruning) {}
+
+				virtual Output accept(_sp<EvaluationVisitor> visitor, _sp<RuleLibrary> library, Input input) override {
+					Output out = FAILURE;
+					const int character = input.tokens->poll(input.idx);
+					for (const string& name : library->getSymbolNames()) {
+						try {
+							const _sp<Rule> symbol = library->getSymbol(name);
+							if (pruning && symbol && !pruning->canStart(library, *symbol, input.idx, character)) {
+								continue;
+							}
+							const Output newOut = visitor->visitSymbol(name, symbol, input);
+							if (newOut.idx > out.idx) {
+								out = newOut;
+							}
+						}
+						catch (string exc) {
+							cout << "\nexception was thrown: " << exc << "\n";
+						}
+					}
+					if (out.isSuccess()) {
+						input.tokens->popRange(out.idx - input.idx);
+						return Output(out.idx);
+					}
+					return out;
+				}
+			protected:
+				_sp<FirstSetPruning> pruning;
+			};
+
 			const static _sp<EvaluationMixins> evaluationMixins = make_shared<EvaluationMixins>();
 
-			static _sp<Strategies<Input, Output>> evaluationStrategies() {
+			/// <summary>
+			/// The strategies, with ors skipping what the pruning says can't start where they are, or as they are without one.
+			/// </summary>
+			static _sp<Strategies<Input, Output>> pruneWith(_sp<Strategies<Input, Output>> strategies, _sp<FirstSetPruning> pruning) {
+				if (!pruning) {
+					return strategies;
+				}
+				return make_shared<FirstSetStrategies>(strategies, pruning, evaluationMixins);
+			}
+
+			/// <summary>
+			/// The strategies, with the repeats the spans can scan for scanning for the end of the run, or as they are without any spans.
+			/// </summary>
+			static _sp<Strategies<Input, Output>> spanWith(_sp<Strategies<Input, Output>> strategies, _sp<CharacterSpans> spans, _sp<FailureTracker> tracker = nullptr) {
+				if (!spans) {
+					return strategies;
+				}
+				return make_shared<SpanStrategies>(strategies, spans, tracker);
+			}
+
+			/// <summary>
+			/// Walks the rules, remembering the results of those the policy picks, whole productions unless told otherwise.
+			/// Symbols and alternatives that can't start with the character they would be tried on are skipped, unless pruning is nullptr,
+			/// and repeats over a class of bytes, or up to a literal, are matched with a scan, unless spans is.
+			/// </summary>
+			static _sp<Strategies<Input, Output>> evaluationStrategies(_sp<MemoPolicy> policy = memoiseProductions(), _sp<FirstSetPruning> pruning = make_shared<FirstSetPruning>(),
+				_sp<CharacterSpans> spans = make_shared<CharacterSpans>()) {
 				auto baseStrategies = make_shared<BaseStrategies<Input, Output>>();
-				auto strategies = cache<Input, Output, Key>(make_shared< SyntaxStrategies>(baseStrategies), evaluationMixins);
+				auto strategies = pruneWith(spanWith(cache<Input, Output, Key>(make_shared< SyntaxStrategies>(baseStrategies), policy, evaluationMixins), spans), pruning);
 				//auto strategies = make_shared<SyntaxStrategies>(baseStrategies);
+				// added first, so it is the one kept.
+				strategies->addStrategy(LogicRules::Operators, make_shared<SyntaxOperatorsRuleStrategy>(evaluationMixins));
+				addLogicStrategies<Input, Output>(evaluationMixins, strategies);
+				strategies->setLibraryStrategy(make_shared<EvaluationLibraryStrategy>(pruning));
+				strategies->addStrategy(StringRules::EqualChar, make_shared<HasCharRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::EqualString, make_shared<StringRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::CharRange, make_shared<CharRangeRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::CharClass, make_shared<CharClassRuleStrategy>(evaluationMixins));
+				return strategies;
+			}
+
+			/// <summary>
+			/// Walks the rules like evaluationStrategies(), but only to find out whether they match, and how far they got.
+			/// </summary>
+			static _sp<Strategies<Input, Output>> recognitionStrategies(_sp<MemoPolicy> policy = memoiseProductions(), _sp<FailureTracker> tracker = make_shared<FailureTracker>(),
+				_sp<FirstSetPruning> pruning = make_shared<FirstSetPruning>(), _sp<CharacterSpans> spans = make_shared<CharacterSpans>()) {
+				if (pruning) {
+					pruning->setTracker(tracker);
+				}
+				auto baseStrategies = make_shared<BaseStrategies<Input, Output>>();
+				auto remembered = make_shared<RememberedFailureStrategies>(make_shared<RecognitionStrategies>(baseStrategies, tracker), tracker);
+				auto strategies = pruneWith(spanWith(cache<Input, Output, Key>(remembered, policy, evaluationMixins), spans, tracker), pruning);
 				addLogicStrategies<Input, Output>(evaluationMixins, strategies);
-				strategies->setLibraryStrategy(make_shared<EvaluationLibraryStrategy>());
+				strategies->setLibraryStrategy(make_shared<RecognitionLibraryStrategy>(pruning));
 				strategies->addStrategy(StringRules::EqualChar, make_shared<HasCharRuleStrategy>(evaluationMixins));
-				strategies->addStrategy(StringRules::EqualString, make_shared<HasStringRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::EqualString, make_shared<StringRuleStrategy>(evaluationMixins));
 				strategies->addStrategy(StringRules::CharRange, make_shared<CharRangeRuleStrategy>(evaluationMixins));
+				strategies->addStrategy(StringRules::CharClass, make_shared<CharClassRuleStrategy>(evaluationMixins));
 				return strategies;
 			}
+
+			/// <summary>
+			/// Whether the whole source parsed, how far it got, and the farthest a terminal failed, which is where to look if it didn't.
+			/// </summary>
+			struct Validation {
+				bool passed = false;
+				int end = 0;
+				int farthest = 0;
+			};
+
+			/// <summary>
+			/// Matches symbol after symbol until the source runs out or nothing matches, without making any nodes.
+			/// </summary>
+			static Validation validate(_sp<RuleLibrary> library, Tokens tokens, _sp<MemoPolicy> policy = memoiseProductions()) {
+				const auto tracker = make_shared<FailureTracker>();
+				const auto strategies = recognitionStrategies(policy, tracker);
+				const auto visitor = make_shared<EvaluationVisitor>(library, strategies);
+				while (true) {
+					visitor->clear();
+					strategies->clear();
+					const Input input = Input(tokens);
+					const Output output = visitor->begin(input);
+					// an empty match would never move us forward.
+					if (output.isFailure() || output.idx == input.idx) {
+						break;
+					}
+				}
+				Validation validation;
+				validation.end = tokens->getStart();
+				validation.passed = tokens->isEnd(validation.end);
+				validation.farthest = std::max(validation.end, tracker->getFarthest());
+				return validation;
+			}
 		}
 
 	}
@@ -17,6 +17,12 @@
 #define FLOCK_COMPILER_STRING_RULES_H
 
 #include "Rules.h"
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <utility>
 #include <vector>
 
  ///
@@ -29,12 +35,202 @@ namespace flock {
 		enum StringRules {
 			CharRange = -101,
 			EqualString = -102,
-			EqualChar = -103
+			EqualChar = -103,
+			CharClass = -104
+		};
+
+		/// <summary>
+		/// One character out of a set, a single lookup however the set was put together.
+		/// Characters are bytes, code points of 0x80 and up are decoded from UTF-8 and match the whole of their encoding.
+		/// A byte in the set is taken on its own, even if it would start the encoding of one of the code points.
+		/// </summary>
+		class CharClassRule : public TerminalRule {
+		public:
+			/// <summary>
+			/// codePoints are inclusive ranges, in any order, the ASCII part of them goes in with the bytes.
+			/// </summary>
+			CharClassRule(const bitset<256>& bytes, vector<pair<int, int>> codePoints = {}) : TerminalRule(StringRules::CharClass), bytes(bytes) {
+				std::sort(codePoints.begin(), codePoints.end());
+				for (pair<int, int> range : codePoints) {
+					for (; range.first <= range.second && range.first < 0x80; range.first++) {
+						if (range.first >= 0) {
+							this->bytes.set(range.first);
+						}
+					}
+					if (range.first > range.second) {
+						continue;
+					}
+					if (!this->codePoints.empty() && range.first <= this->codePoints.back().second + 1) {
+						this->codePoints.back().second = std::max(this->codePoints.back().second, range.second);
+					}
+					else {
+						this->codePoints.push_back(range);
+					}
+				}
+			}
+
+			const bitset<256>& getBytes() const {
+				return bytes;
+			}
+			/// <summary>
+			/// Sorted and merged, all of them 0x80 and up.
+			/// </summary>
+			const vector<pair<int, int>>& getCodePoints() const {
+				return codePoints;
+			}
+			bool hasCodePoints() const {
+				return !codePoints.empty();
+			}
+
+			bool containsCodePoint(const int codePoint) const {
+				auto after = std::upper_bound(codePoints.begin(), codePoints.end(), pair<int, int>(codePoint, INT_MAX));
+				return after != codePoints.begin() && (after - 1)->second >= codePoint;
+			}
+
+			/// <summary>
+			/// How many characters match at position, 0 if none do.
+			/// poll gives the character at a position, or EOF if there isn't one.
+			/// </summary>
+			template<typename POLL>
+			int matchAt(const int position, POLL poll) const {
+				const int first = poll(position);
+				if (first == EOF) {
+					return 0;
+				}
+				if (bytes.test(first)) {
+					return 1;
+				}
+				if (first < 0x80 || codePoints.empty()) {
+					return 0;
+				}
+				int length;
+				int codePoint;
+				if ((first & 0xE0) == 0xC0) {
+					length = 2;
+					codePoint = first & 0x1F;
+				}
+				else if ((first & 0xF0) == 0xE0) {
+					length = 3;
+					codePoint = first & 0x0F;
+				}
+				else if ((first & 0xF8) == 0xF0) {
+					length = 4;
+					codePoint = first & 0x07;
+				}
+				else {
+					return 0;
+				}
+				for (int i = 1; i < length; i++) {
+					const int next = poll(position + i);
+					if (next == EOF || (next & 0xC0) != 0x80) {
+						return 0;
+					}
+					codePoint = (codePoint << 6) | (next & 0x3F);
+				}
+				// the shortest encoding is the only one.
+				static constexpr int SMALLEST[] = { 0, 0, 0x80, 0x800, 0x10000 };
+				if (codePoint < SMALLEST[length] || codePoint > 0x10FFFF) {
+					return 0;
+				}
+				return containsCodePoint(codePoint) ? length : 0;
+			}
+
+		protected:
+			bitset<256> bytes;
+			vector<pair<int, int>> codePoints;
+		};
+
+		/// <summary>
+		/// The strings of an equals, as a trie of their bytes, so the longest of them at a position is found in one pass over the source, however many there are.
+		/// Each node's edges are kept together, sorted by byte, and found with a binary search.
+		/// </summary>
+		class StringTrie {
+		public:
+			StringTrie(const vector<string>& values) {
+				// built with a map per node, then laid out flat.
+				vector<map<unsigned char, int>> children(1);
+				vector<bool> accepts(1, false);
+				for (const string& value : values) {
+					int node = 0;
+					for (const char character : value) {
+						auto child = children[node].find(static_cast<unsigned char>(character));
+						if (child == children[node].end()) {
+							child = children[node].emplace(static_cast<unsigned char>(character), static_cast<int>(children.size())).first;
+							children.emplace_back();
+							accepts.push_back(false);
+						}
+						node = child->second;
+					}
+					accepts[node] = true;
+				}
+				nodes.resize(children.size());
+				for (size_t node = 0; node < children.size(); node++) {
+					nodes[node].first = static_cast<int>(edges.size());
+					nodes[node].accepts = accepts[node];
+					for (const auto& child : children[node]) {
+						edges.push_back(Edge{ child.first, child.second });
+					}
+					nodes[node].last = static_cast<int>(edges.size());
+				}
+			}
+
+			/// <summary>
+			/// The length of the longest of the strings the source has at position, -1 if it has none of them.
+			/// poll(position) gives the character there, or EOF.
+			/// </summary>
+			template<typename POLL>
+			int longestAt(const int position, POLL poll) const {
+				int longest = nodes[0].accepts ? 0 : -1;
+				int node = 0;
+				for (int length = 0;; length++) {
+					const int character = poll(position + length);
+					if (character == EOF) {
+						break;
+					}
+					node = next(node, static_cast<unsigned char>(character));
+					if (node < 0) {
+						break;
+					}
+					if (nodes[node].accepts) {
+						longest = length + 1;
+					}
+				}
+				return longest;
+			}
+
+			size_t size() const {
+				return nodes.size();
+			}
+
+		protected:
+			struct Edge {
+				unsigned char character;
+				int node;
+			};
+			struct Node {
+				// its edges, from first up to last.
+				int first = 0;
+				int last = 0;
+				bool accepts = false;
+			};
+
+			int next(const int node, const unsigned char character) const {
+				const auto begin = edges.begin() + nodes[node].first;
+				const auto end = edges.begin() + nodes[node].last;
+				const auto edge = std::lower_bound(begin, end, character, [](const Edge& edge, const unsigned char value) { return edge.character < value; });
+				return edge != end && edge->character == character ? edge->node : -1;
+			}
+
+			vector<Node> nodes;
+			vector<Edge> edges;
 		};
 
 		static _sp<Rule> EQ(string value) {
 			return _valueRule<string>(StringRules::EqualString, value);
 		}
+		/// <summary>
+		/// Whichever of the strings is the longest the source has at the position.
+		/// </summary>
 		static _sp<Rule> EQ(vector<string> values) {
 			return _valueRule<string>(StringRules::EqualString, values);
 		}
@@ -53,6 +249,18 @@ namespace flock {
 		static _sp<Rule> RANGE(int start, int end) {
 			return _valueRule<int>(StringRules::CharRange, start, end);
 		}
+		static _sp<Rule> CLASS(const bitset<256>& bytes) {
+			return make_shared<CharClassRule>(bytes);
+		}
+		/// <summary>
+		/// Code points, as inclusive ranges, matched in UTF-8.
+		/// </summary>
+		static _sp<Rule> CLASS(vector<pair<int, int>> codePoints) {
+			return make_shared<CharClassRule>(bitset<256>(), codePoints);
+		}
+		static _sp<Rule> CLASS(initializer_list<pair<int, int>> codePoints) {
+			return CLASS(vector<pair<int, int>>(codePoints));
+		}
 		static _sp<Rule> NEW_LINE() {
 			return  EQ({ '\n', '\r' });
 		}
@@ -17,15 +17,66 @@
 #ifndef FLOCK_COMPILER_SUPPLIER_H
 #define FLOCK_COMPILER_SUPPLIER_H
 
+#include <cstdio>
+
 namespace flock {
     namespace supplier {
 
+        /// <summary>
+        /// What a supplier hands back once it has nothing left, nullptr for pointers.
+        /// </summary>
+        template<typename Contents>
+        struct SupplierTraits {
+            static bool isEnd(const Contents& value) {
+                return !value;
+            }
+        };
+
+        /// <summary>
+        /// Character suppliers finish with EOF.
+        /// </summary>
+        template<>
+        struct SupplierTraits<int> {
+            static bool isEnd(const int value) {
+                return value == EOF;
+            }
+        };
+
         template<typename Contents>
         class Supplier
         {
         public:
             virtual ~Supplier() = default;
             virtual Contents supply() = 0;
+
+            /// <summary>
+            /// Whether supply() can hand back another element without waiting for it.
+            /// Nothing is known about an arbitrary supplier, so it isn't assumed.
+            /// </summary>
+            virtual bool isAvailable() {
+                return false;
+            }
+
+            /// <summary>
+            /// Fills into with up to amount elements, and returns how many it filled, 0 once there is nothing left.
+            /// Fewer than amount doesn't mean the end, a supplier can hand back what it has rather than wait for more.
+            /// This waits on supply() for the first element, and only goes on while isAvailable() says the next won't wait,
+            /// so interactive input isn't held up filling a block. Anything that has its elements to hand should override it.
+            /// </summary>
+            virtual int supplyInto(Contents* into, const int amount) {
+                int count = 0;
+                while (count < amount) {
+                    Contents next = supply();
+                    if (SupplierTraits<Contents>::isEnd(next)) {
+                        break;
+                    }
+                    into[count++] = next;
+                    if (!isAvailable()) {
+                        break;
+                    }
+                }
+                return count;
+            }
         };
     }
 }
@@ -19,6 +19,7 @@
 #include "Source.h"
 #include "Visitor.h"
 #include "ConsoleFormat.h"
+#include <unordered_map>
 
  ///
  /// Basic Grammar, that allows to employ basic BNF style grammars in language detection.
@@ -42,55 +43,39 @@ namespace flock {
 
 
 
-		class SyntaxNode : public enable_shared_from_this<SyntaxNode> {
+		/// <summary>
+		/// A node of the syntax tree, never changed once it has been made.
+		///
+		/// Because nothing about a node depends on where it is, a parent adopts its children as they are, memoised or not, rather than copying them.
+		/// Nodes only point down the tree, so a tree is freed as soon as its root is let go of, use SyntaxParents to walk back up.
+		/// </summary>
+		class SyntaxNode {
 		public:
 			SyntaxNode(string type) : type(type), range(nullptr) {}
 			SyntaxNode(_sp<Range> range) : range(range) {}
-			SyntaxNode(string type, _sp<Range> range) : type(type), range(range) {}
+			SyntaxNode(string type, _sp<Range> range, _sp_vec<SyntaxNode> children = {}) : type(type), range(range), children(std::move(children)) {}
 
-			_sp<SyntaxNode> clone() {
-				_sp<SyntaxNode> me = make_shared<SyntaxNode>(type, range);
-
-				for (_sp<SyntaxNode> child : SyntaxNode::children) {
-					me->append(child->clone());
-				}
-				return me;
+			const string& getType() const {
+				return type;
 			}
-			_sp_vec<SyntaxNode> getChildren() {
+			const _sp_vec<SyntaxNode>& getChildren() const {
 				return children;
 			}
-			_sp<Range> getRange() {
+			const _sp<Range>& getRange() const {
 				return range;
 			}
-			_sp<SyntaxNode> getParent() {
-				return parent;
-			}
-
-			void setParent(_sp<SyntaxNode> parentToSet) {
-				parent = parentToSet;
-			}
-			void setRange(_sp<Range> newRange) {
-				range = newRange;
-			}
-
-			void append(_sp<SyntaxNode> syntaxNode) {
-				children.push_back(syntaxNode);
-				syntaxNode->setParent(this->shared_from_this());
-			}
 
 			/// <summary>
 			/// TODO probably remove
 			/// </summary>
 			/// <returns></returns>
-			_sp<Range> getFullRange() {
-				if (range == nullptr) {
-					range = getCombinedChildrenRange();
-				}
-				return range;
+			_sp<Range> getFullRange() const {
+				return range ? range : getCombinedChildrenRange();
 			}
 
 			friend std::ostream& operator<<(std::ostream& os, const SyntaxNode& node) {
-				string printRange = node.range ? ": \"" + colourize(colour::Colour::GREEN, node.range->source) +"\"": "";
+				string printRange = !node.range ? "" : node.range->isReleased() ? string(": ") + Range::RELEASED
+					: ": \"" + colourize(colour::Colour::GREEN, node.range->copySource()) + "\"";
 				os << "{ " << colourize(colour::Colour::YELLOW, node.type) << printRange;
 				if (!node.children.empty()) {
 
@@ -98,7 +83,7 @@ namespace flock {
 					if (node.children.size() > 1) {
 						os << "[";
 					}
-					for (_sp<SyntaxNode> child : node.children) {
+					for (const _sp<SyntaxNode>& child : node.children) {
 						os << *child;
 					}
 					if (node.children.size() > 1) {
@@ -109,17 +94,16 @@ namespace flock {
 			};
 
 		protected:
-			string type;
-			_sp<Range> range = nullptr;
-			_sp_vec<SyntaxNode> children;
-			_sp<SyntaxNode> parent = nullptr;
+			const string type;
+			const _sp<Range> range = nullptr;
+			const _sp_vec<SyntaxNode> children;
 
 
 			/// <summary>
 			/// TODO probably remove
 			/// </summary>
 			/// <returns></returns>
-			_sp<Range> getCombinedChildrenRange() {
+			_sp<Range> getCombinedChildrenRange() const {
 
 				if (children.empty()) {
 					return nullptr;
@@ -140,6 +124,48 @@ namespace flock {
 				return range;
 			}
 		};
+
+		/// <summary>
+		/// The parent of each node under a root, worked out when it is asked for rather than kept in the nodes.
+		///
+		/// A node adopted in more than one place reports the first parent found, walking the tree depth first.
+		/// Only good for as long as the root is held on to.
+		/// </summary>
+		class SyntaxParents {
+		public:
+			SyntaxParents(const _sp<SyntaxNode>& root) : root(root) {
+				if (!root) {
+					return;
+				}
+				// symbols nest as deep as the source nests them, which nothing bounds, so the walk keeps its own stack rather than recursing.
+				vector<const SyntaxNode*> pending = { root.get() };
+				while (!pending.empty()) {
+					const SyntaxNode* node = pending.back();
+					pending.pop_back();
+					for (const _sp<SyntaxNode>& child : node->getChildren()) {
+						if (child && parents.emplace(child.get(), node).second) {
+							pending.push_back(child.get());
+						}
+					}
+				}
+			}
+
+			/// <summary>
+			/// The parent of node, or nullptr for the root, or for a node that isn't under it.
+			/// </summary>
+			const SyntaxNode* getParent(const SyntaxNode* node) const {
+				auto found = parents.find(node);
+				return found == parents.end() ? nullptr : found->second;
+			}
+
+			const _sp<SyntaxNode>& getRoot() const {
+				return root;
+			}
+
+		protected:
+			const _sp<SyntaxNode> root;
+			std::unordered_map<const SyntaxNode*, const SyntaxNode*> parents;
+		};
 	}
 }
 
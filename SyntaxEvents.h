@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_SYNTAX_EVENTS_H
+#define FLOCK_COMPILER_SYNTAX_EVENTS_H
+
+#include "Util.h"
+#include "Syntax.h"
+#include "SyntaxTree.h"
+#include <string>
+#include <vector>
+
+namespace flock {
+	namespace syntax {
+
+		/// <summary>
+		/// Takes a parse as a stream of events, in source order, rather than as a tree.
+		///
+		/// A symbol with symbols under it is an enter, the events for those, then an exit, a symbol with none is a single token.
+		/// Events are only sent once they can't be backtracked over, so nothing sent is ever taken back.
+		/// Positions are as the tree has them, NO_POSITION for a symbol matched at the very end of the source.
+		/// </summary>
+		class SyntaxConsumer {
+		public:
+			virtual ~SyntaxConsumer() = default;
+			virtual void enter(const string& symbol, const int start) = 0;
+			virtual void exit(const string& symbol, const int end) = 0;
+			virtual void token(const string& symbol, const int start, const int end) = 0;
+		};
+
+		/// <summary>
+		/// Sends root, and everything under it, to the consumer.
+		/// </summary>
+		static void emitEvents(const SyntaxTree& tree, const SyntaxTree::Handle root, SyntaxConsumer& consumer) {
+			if (root == SyntaxTree::NONE) {
+				return;
+			}
+			// the symbols entered and not yet exited, innermost last.
+			std::vector<SyntaxTree::Handle> open;
+			SyntaxTree::Handle node = root;
+			while (true) {
+				const SyntaxTree::Handle child = tree.getFirstChild(node);
+				if (child != SyntaxTree::NONE) {
+					consumer.enter(tree.typeName(tree.getType(node)), tree.getStart(node));
+					open.push_back(node);
+					node = child;
+					continue;
+				}
+				consumer.token(tree.typeName(tree.getType(node)), tree.getStart(node), tree.getEnd(node));
+				// on to the next sibling, exiting everything that has run out of them.
+				while (true) {
+					if (node == root) {
+						return;
+					}
+					const SyntaxTree::Handle sibling = tree.getNextSibling(node);
+					if (sibling != SyntaxTree::NONE) {
+						node = sibling;
+						break;
+					}
+					node = open.back();
+					open.pop_back();
+					consumer.exit(tree.typeName(tree.getType(node)), tree.getEnd(node));
+				}
+			}
+		}
+
+		/// <summary>
+		/// Sends node, and everything under it, to the consumer, for trees that were built as SyntaxNodes.
+		/// </summary>
+		static void emitEvents(const SyntaxNode& node, SyntaxConsumer& consumer) {
+			SyntaxTree tree;
+			emitEvents(tree, tree.add(node), consumer);
+		}
+	}
+}
+
+#endif
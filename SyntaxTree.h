@@ -0,0 +1,390 @@
+/*
+ * Copyright 2020 John Orlando Keleshian Moxley, All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FLOCK_COMPILER_SYNTAX_TREE_H
+#define FLOCK_COMPILER_SYNTAX_TREE_H
+
+#include "Util.h"
+#include "Source.h"
+#include "Syntax.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace flock {
+	namespace syntax {
+		using namespace flock::source;
+
+		/// <summary>
+		/// A forest of syntax nodes held in a handful of flat arrays, one entry per node, a node being its index into them.
+		///
+		/// Nodes are stored in the order they are opened, so each subtree is one contiguous run, and walking the arrays front to back visits the nodes depth first.
+		/// Node types are interned, so a node costs five ints, against the several separate allocations a SyntaxNode takes.
+		/// </summary>
+		class SyntaxTree {
+		public:
+			using Handle = int32_t;
+			static constexpr Handle NONE = -1;
+			// the start and end of a node that had no range, the way a SyntaxNode at the end of the source has none.
+			static constexpr int NO_POSITION = -1;
+
+			class Cursor;
+
+			SyntaxTree(_sp<SourceText> text = nullptr) : text(text) {}
+
+			size_t size() const {
+				return types.size();
+			}
+
+			bool empty() const {
+				return types.empty();
+			}
+
+			/// <summary>
+			/// The id for the type name, making one if there isn't one yet.
+			/// </summary>
+			int typeId(const string& name) {
+				auto found = typeIds.find(name);
+				if (found != typeIds.end()) {
+					return found->second;
+				}
+				const int id = static_cast<int>(typeNames.size());
+				typeNames.push_back(name);
+				typeIds.emplace(name, id);
+				return id;
+			}
+
+			/// <summary>
+			/// The id for the type name, or -1 if no node has ever had it.
+			/// </summary>
+			int findType(const string& name) const {
+				auto found = typeIds.find(name);
+				return found == typeIds.end() ? -1 : found->second;
+			}
+
+			const string& typeName(const int id) const {
+				return typeNames.at(id);
+			}
+
+			int getType(const Handle node) const {
+				return types[node];
+			}
+			int getStart(const Handle node) const {
+				return starts[node];
+			}
+			int getEnd(const Handle node) const {
+				return ends[node];
+			}
+			Handle getFirstChild(const Handle node) const {
+				return firstChildren[node];
+			}
+			Handle getNextSibling(const Handle node) const {
+				return nextSiblings[node];
+			}
+			/// <summary>
+			/// The first of the top level nodes, the rest following on as its siblings.
+			/// </summary>
+			Handle getFirstRoot() const {
+				return empty() ? NONE : 0;
+			}
+
+			const _sp<SourceText>& getText() const {
+				return text;
+			}
+			void setText(_sp<SourceText> textToSet) {
+				text = textToSet;
+			}
+
+			/// <summary>
+			/// The text of the node, in place, see SourceText::view for how long it is good for.
+			/// Throws if the source has released it.
+			/// </summary>
+			std::string_view getSource(const Handle node) const {
+				if (!text || starts[node] == NO_POSITION) {
+					return std::string_view();
+				}
+				return text->viewHeld(starts[node], ends[node]);
+			}
+
+			void reserve(const size_t nodes) {
+				types.reserve(nodes);
+				starts.reserve(nodes);
+				ends.reserve(nodes);
+				firstChildren.reserve(nodes);
+				nextSiblings.reserve(nodes);
+			}
+
+			/// <summary>
+			/// Starts a node, as the next child of the node still open, or as the next root if none is.
+			/// Everything opened until it is closed goes under it.
+			/// </summary>
+			Handle open(const int type, const int start) {
+				const Handle node = static_cast<Handle>(types.size());
+				types.push_back(type);
+				starts.push_back(start);
+				ends.push_back(start);
+				firstChildren.push_back(NONE);
+				nextSiblings.push_back(NONE);
+				Handle& last = building.empty() ? lastRoot : building.back().lastChild;
+				if (last != NONE) {
+					nextSiblings[last] = node;
+				}
+				else if (!building.empty()) {
+					firstChildren[building.back().node] = node;
+				}
+				last = node;
+				building.push_back(Open{ node, NONE });
+				return node;
+			}
+
+			/// <summary>
+			/// Ends the node opened last, a node opened without a start is left without an end too.
+			/// </summary>
+			void close(const int end) {
+				if (building.empty()) {
+					throw string("No syntax tree node is open to close");
+				}
+				const Handle node = building.back().node;
+				ends[node] = starts[node] == NO_POSITION ? NO_POSITION : end;
+				building.pop_back();
+			}
+
+			/// <summary>
+			/// Copies node and everything under it in, as the next root or as the next child of the node still open.
+			/// </summary>
+			Handle add(const SyntaxNode& node) {
+				struct Pending {
+					const SyntaxNode* node;
+					size_t child;
+				};
+				const Handle added = openNode(node);
+				// the depth is how far the symbols nest, with no limit on it, so the copy is driven from a stack of pending nodes, not by recursion.
+				vector<Pending> pending = { Pending{ &node, 0 } };
+				while (!pending.empty()) {
+					Pending& top = pending.back();
+					const _sp_vec<SyntaxNode>& children = top.node->getChildren();
+					if (top.child == children.size()) {
+						pending.pop_back();
+						close(ends[building.back().node]);
+						continue;
+					}
+					const _sp<SyntaxNode>& child = children[top.child++];
+					if (child) {
+						openNode(*child);
+						pending.push_back(Pending{ child.get(), 0 });
+					}
+				}
+				return added;
+			}
+
+			/// <summary>
+			/// The node as a SyntaxNode, for anything that still wants one.
+			/// </summary>
+			_sp<SyntaxNode> toNode(const Handle node) const {
+				struct Pending {
+					Handle node;
+					Handle child;
+					_sp_vec<SyntaxNode> children;
+				};
+				vector<Pending> pending;
+				pending.push_back(Pending{ node, firstChildren[node], {} });
+				while (true) {
+					Pending& top = pending.back();
+					if (top.child != NONE) {
+						const Handle child = top.child;
+						top.child = nextSiblings[child];
+						pending.push_back(Pending{ child, firstChildren[child], {} });
+						continue;
+					}
+					const Handle made = top.node;
+					_sp<SyntaxNode> syntaxNode = make_shared<SyntaxNode>(typeNames[types[made]], rangeOf(made), std::move(top.children));
+					pending.pop_back();
+					if (pending.empty()) {
+						return syntaxNode;
+					}
+					pending.back().children.push_back(std::move(syntaxNode));
+				}
+			}
+
+			/// <summary>
+			/// Every root as a SyntaxNode, in order.
+			/// </summary>
+			_sp_vec<SyntaxNode> toNodes() const {
+				_sp_vec<SyntaxNode> roots;
+				for (Handle root = getFirstRoot(); root != NONE; root = nextSiblings[root]) {
+					roots.push_back(toNode(root));
+				}
+				return roots;
+			}
+
+			Cursor cursor(const Handle node = 0) const;
+
+			/// <summary>
+			/// Bytes reserved for the nodes and their type names.
+			/// </summary>
+			size_t memoryBytes() const {
+				size_t bytes = (types.capacity() + starts.capacity() + ends.capacity() + firstChildren.capacity() + nextSiblings.capacity()) * sizeof(int32_t);
+				for (const string& name : typeNames) {
+					bytes += sizeof(string) + name.capacity();
+				}
+				return bytes;
+			}
+
+			void clear() {
+				types.clear();
+				starts.clear();
+				ends.clear();
+				firstChildren.clear();
+				nextSiblings.clear();
+				building.clear();
+				lastRoot = NONE;
+			}
+
+		protected:
+			struct Open {
+				Handle node;
+				Handle lastChild;
+			};
+
+			Handle openNode(const SyntaxNode& node) {
+				const _sp<Range>& range = node.getRange();
+				if (range && !text) {
+					text = range->getText();
+				}
+				const Handle opened = open(typeId(node.getType()), range ? range->start : NO_POSITION);
+				ends[opened] = range ? range->end : NO_POSITION;
+				return opened;
+			}
+
+			_sp<Range> rangeOf(const Handle node) const {
+				if (!text || starts[node] == NO_POSITION) {
+					return nullptr;
+				}
+				return make_shared<Range>(text, starts[node], ends[node]);
+			}
+
+			vector<int32_t> types;
+			vector<int32_t> starts;
+			vector<int32_t> ends;
+			vector<Handle> firstChildren;
+			vector<Handle> nextSiblings;
+
+			vector<string> typeNames;
+			std::unordered_map<string, int> typeIds;
+			_sp<SourceText> text;
+
+			// the nodes opened but not yet closed, innermost last.
+			vector<Open> building;
+			Handle lastRoot = NONE;
+		};
+
+		/// <summary>
+		/// Walks a SyntaxTree, remembering the way down so it can come back up.
+		/// </summary>
+		class SyntaxTree::Cursor {
+		public:
+			Cursor(const SyntaxTree& tree, const Handle node) : tree(&tree), node(node < static_cast<Handle>(tree.size()) ? node : NONE) {}
+
+			bool isValid() const {
+				return node != NONE;
+			}
+			Handle getHandle() const {
+				return node;
+			}
+			int getType() const {
+				return tree->getType(node);
+			}
+			const string& getTypeName() const {
+				return tree->typeName(tree->getType(node));
+			}
+			int getStart() const {
+				return tree->getStart(node);
+			}
+			int getEnd() const {
+				return tree->getEnd(node);
+			}
+			std::string_view getSource() const {
+				return tree->getSource(node);
+			}
+			/// <summary>
+			/// How many parents the cursor has come down through.
+			/// </summary>
+			size_t getDepth() const {
+				return ancestors.size();
+			}
+
+			bool gotoFirstChild() {
+				const Handle child = tree->getFirstChild(node);
+				if (child == NONE) {
+					return false;
+				}
+				ancestors.push_back(node);
+				node = child;
+				return true;
+			}
+
+			bool gotoNextSibling() {
+				const Handle sibling = tree->getNextSibling(node);
+				if (sibling == NONE) {
+					return false;
+				}
+				node = sibling;
+				return true;
+			}
+
+			/// <summary>
+			/// Back up to the parent, as long as the cursor came down through it.
+			/// </summary>
+			bool gotoParent() {
+				if (ancestors.empty()) {
+					return false;
+				}
+				node = ancestors.back();
+				ancestors.pop_back();
+				return true;
+			}
+
+			/// <summary>
+			/// On to the next node depth first, the first child, or else the next sibling of the nearest node that has one.
+			/// False once there are none left, with the cursor no longer valid.
+			/// </summary>
+			bool gotoNext() {
+				if (gotoFirstChild() || gotoNextSibling()) {
+					return true;
+				}
+				while (gotoParent()) {
+					if (gotoNextSibling()) {
+						return true;
+					}
+				}
+				node = NONE;
+				return false;
+			}
+
+		protected:
+			const SyntaxTree* tree;
+			Handle node;
+			vector<Handle> ancestors;
+		};
+
+		inline SyntaxTree::Cursor SyntaxTree::cursor(const Handle node) const {
+			return Cursor(*this, node);
+		}
+	}
+}
+
+#endif
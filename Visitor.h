@@ -21,6 +21,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <cassert>
 
  ///
  /// A Reusable VisitorStrategyPattern.
@@ -63,6 +64,14 @@ namespace flock {
 				return it->second;
 			}
 
+			/// <summary>
+			/// Where the node named is held, which stays put for as long as the library does, or nullptr.
+			/// </summary>
+			const _sp<NODE>* findNode(const string& name) const {
+				auto it = nodes.find(name);
+				return it == nodes.end() ? nullptr : &it->second;
+			}
+
 			vector<string> getNames() {
 				return names;
 			}
@@ -79,6 +88,13 @@ namespace flock {
 			virtual _sp<STRATEGY> getStrategy(_sp<NODE> node) {
 				return getStrategyById(node->type);
 			}
+			/// <summary>
+			/// The same as getStrategyById, without the copy, for the visitor to use on every visit.
+			/// Override both, or neither.
+			/// </summary>
+			virtual STRATEGY* strategyFor(const int typeId) {
+				return getStrategyById(typeId).get();
+			}
 			virtual void addStrategy(const int type, _sp<STRATEGY> strategy) = 0;
 			virtual _sp<LIBRARY_STRATEGY> getLibraryStrategy() = 0;
 			virtual void setLibraryStrategy(_sp<LIBRARY_STRATEGY> strategy) = 0;
@@ -86,20 +102,40 @@ namespace flock {
 			}
 		};
 
+		/// <summary>
+		/// Strategies are looked up on every visit, so type ids near zero, the negative ones reserved by the API and the first of the user ones,
+		/// are indexed directly, and only ids further out than DENSE_TYPES go in a map.
+		/// The first strategy added for a type is the one that is kept.
+		/// </summary>
 		template<typename IN, typename OUT, typename NODE, typename STRATEGY, typename LIBRARY_STRATEGY>
 		class BaseStrategies : public Strategies<IN, OUT, NODE, STRATEGY, LIBRARY_STRATEGY> {
 		public:
+			static constexpr int DENSE_TYPES = 1024;
+
 			BaseStrategies() {}
 			virtual _sp<STRATEGY> getStrategyById(const int typeId) override {
-				auto it = strategyMap.find(typeId);
-				if (it == strategyMap.end()) {
-					return nullptr;
-				}
-				return it->second;
+				_sp<STRATEGY>* slot = find(typeId);
+				return slot ? *slot : nullptr;
+			}
+
+			virtual STRATEGY* strategyFor(const int typeId) override {
+				_sp<STRATEGY>* slot = find(typeId);
+				return slot ? slot->get() : nullptr;
 			}
 
 			virtual void addStrategy(const int type, _sp<STRATEGY> strategy)  override {
-				strategyMap.emplace(type, strategy);
+				if (type <= -DENSE_TYPES || type >= DENSE_TYPES) {
+					sparse.emplace(type, strategy);
+					return;
+				}
+				vector<_sp<STRATEGY>>& dense = type < 0 ? negative : positive;
+				const size_t index = type < 0 ? -type : type;
+				if (dense.size() <= index) {
+					dense.resize(index + 1);
+				}
+				if (!dense[index]) {
+					dense[index] = strategy;
+				}
 			}
 
 			virtual _sp<LIBRARY_STRATEGY> getLibraryStrategy()  override {
@@ -110,7 +146,23 @@ namespace flock {
 				libraryStrategy = strategy;
 			}
 		protected:
-			map<int, _sp<STRATEGY>> strategyMap;
+			_sp<STRATEGY>* find(const int typeId) {
+				if (typeId < 0 && typeId > -DENSE_TYPES) {
+					const size_t index = -typeId;
+					return index < negative.size() && negative[index] ? &negative[index] : nullptr;
+				}
+				if (typeId >= 0 && typeId < DENSE_TYPES) {
+					const size_t index = typeId;
+					return index < positive.size() && positive[index] ? &positive[index] : nullptr;
+				}
+				auto it = sparse.find(typeId);
+				return it == sparse.end() ? nullptr : &it->second;
+			}
+
+			// indexed by -type
+			vector<_sp<STRATEGY>> negative;
+			vector<_sp<STRATEGY>> positive;
+			map<int, _sp<STRATEGY>> sparse;
 			_sp<LIBRARY_STRATEGY> libraryStrategy;
 		};
 
@@ -127,6 +179,10 @@ namespace flock {
 				return strategies->getStrategy(node);
 			}
 
+			virtual STRATEGY* strategyFor(const int typeId) override {
+				return strategies->strategyFor(typeId);
+			}
+
 			virtual void addStrategy(const int type, _sp<STRATEGY> strategy)  override {
 				strategies->addStrategy(type, strategy);
 			}
@@ -149,6 +205,21 @@ namespace flock {
 			_sp<Strategies<IN, OUT, NODE, STRATEGY, LIBRARY_STRATEGY>> strategies;
 		};
 
+		/// <summary>
+		/// The strategies, or the first of those they wrap, that are a FOUND, nullptr if none of them are.
+		/// </summary>
+		template<typename FOUND, typename IN, typename OUT, typename NODE, typename STRATEGY, typename LIBRARY_STRATEGY>
+		static _sp<FOUND> findStrategies(_sp<Strategies<IN, OUT, NODE, STRATEGY, LIBRARY_STRATEGY>> strategies) {
+			while (strategies) {
+				if (_sp<FOUND> found = std::dynamic_pointer_cast<FOUND>(strategies)) {
+					return found;
+				}
+				const auto wrapping = std::dynamic_pointer_cast<WrappingStrategies<IN, OUT, NODE, STRATEGY, LIBRARY_STRATEGY>>(strategies);
+				strategies = wrapping ? wrapping->getWrappedStratagies() : nullptr;
+			}
+			return nullptr;
+		}
+
 		template<typename IN, typename OUT, typename NODE, typename VISITOR>
 		class Strategy {
 		public:
@@ -156,6 +227,28 @@ namespace flock {
 			virtual OUT accept(_sp<VISITOR> visitor, _sp<NODE> node, IN input) = 0;
 		};
 
+		/// <summary>
+		/// The node as what its type id says it is.
+		/// Strategies are registered by type id, so only debug builds pay to check it.
+		/// </summary>
+		template<typename TYPED, typename NODE>
+		static TYPED& nodeAs(const _sp<NODE>& node) {
+			assert(dynamic_cast<TYPED*>(node.get()) != nullptr);
+			return static_cast<TYPED&>(*node);
+		}
+
+		/// <summary>
+		/// A strategy that is handed its node already cast to TYPED.
+		/// DERIVED provides a public acceptTyped(visitor, TYPED&, input), which is called directly rather than through another virtual.
+		/// </summary>
+		template<typename IN, typename OUT, typename NODE, typename VISITOR, typename TYPED, typename DERIVED>
+		class TypedStrategy : public Strategy<IN, OUT, NODE, VISITOR> {
+		public:
+			virtual OUT accept(_sp<VISITOR> visitor, _sp<NODE> node, IN input) override {
+				return static_cast<DERIVED*>(this)->acceptTyped(visitor, nodeAs<TYPED>(node), input);
+			}
+		};
+
 		template<typename IN, typename OUT, typename NODE, typename VISITOR, typename LIBRARY>
 		class LibraryStrategy {
 		public:
@@ -208,7 +301,10 @@ namespace flock {
 			Visitor(_sp<LIBRARY> library, _sp<STRATEGIES> strategies) : library(library), strategies(strategies) {}
 
 			virtual OUT visit(_sp<NODE> node, IN input) {
-				auto strategy = strategies->getStrategy(node);
+				auto strategy = strategies->strategyFor(node->type);
+				if (!strategy) {
+					throw string("No strategy for type " + to_string(node->type));
+				}
 				return strategy->accept(this->shared_from_this(), node, input);
 			}
 
@@ -231,7 +327,7 @@ namespace flock {
 
 			virtual void clear() {
 			}
-			_sp<LIBRARY> getLibrary() {
+			const _sp<LIBRARY>& getLibrary() {
 				return library;
 			}
 